@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "CapsCache.h"
+#include "Logger.h"
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSettings>
+#include <QXmppDiscoveryIq.h>
+
+CapsCache *CapsCache::instance()
+{
+    static CapsCache *cache = 0;
+    if (cache == 0)
+        cache = new CapsCache;
+    return cache;
+}
+
+CapsCache::CapsCache()
+{
+    // next to the settings file, needs the application names to be set
+    QSettings settings;
+    m_fileName = QFileInfo(settings.fileName()).absolutePath() + "/caps.ini";
+    load();
+}
+
+bool CapsCache::contains(const QString &ver) const
+{
+    return m_features.contains(ver);
+}
+
+bool CapsCache::hasFeature(const QString &ver, const QString &feature) const
+{
+    QHash<QString, QSet<QString> >::const_iterator it = m_features.constFind(ver);
+    return it != m_features.constEnd() && it.value().contains(feature);
+}
+
+void CapsCache::insert(const QString &ver, const QStringList &features)
+{
+    if (m_features.contains(ver))
+        return;
+    m_features.insert(ver, features.toSet());
+    save();
+}
+
+QString CapsCache::verificationString(const QXmppDiscoveryIq &iq)
+{
+    QStringList identities;
+    foreach (const QXmppDiscoveryIq::Identity &identity, iq.identities()) {
+        identities << QString("%1/%2//%3").arg(identity.category())
+                      .arg(identity.type()).arg(identity.name());
+    }
+    QStringList features = iq.features();
+    identities.sort();
+    features.sort();
+
+    QString text;
+    foreach (const QString &identity, identities) {
+        text += identity + '<';
+    }
+    foreach (const QString &feature, features) {
+        text += feature + '<';
+    }
+    return QString::fromAscii(QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toBase64());
+}
+
+void CapsCache::load()
+{
+    QSettings settings(m_fileName, QSettings::IniFormat);
+    int count = settings.beginReadArray("caps");
+    for (int i = 0; i < count; i++) {
+        settings.setArrayIndex(i);
+        m_features.insert(settings.value("ver").toString(),
+                          settings.value("features").toStringList().toSet());
+    }
+    settings.endArray();
+    LOG_DEBUG(QString("[CapsCache] %1 entries from %2").arg(count).arg(m_fileName));
+}
+
+void CapsCache::save() const
+{
+    QSettings settings(m_fileName, QSettings::IniFormat);
+    settings.remove("caps");
+    settings.beginWriteArray("caps", m_features.count());
+    int i = 0;
+    QHash<QString, QSet<QString> >::const_iterator it;
+    for (it = m_features.constBegin(); it != m_features.constEnd(); ++it, ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("ver", it.key());
+        settings.setValue("features", QStringList(it.value().toList()));
+    }
+    settings.endArray();
+}
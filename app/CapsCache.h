@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CAPSCACHE_H
+#define CAPSCACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QXmppDiscoveryIq;
+
+// Feature sets of XEP-0115 entity capabilities, by verification string.
+// Every contact running the same client build announces the same string,
+// so one disco#info answer serves all of them, across accounts and across
+// sessions: the cache is kept in caps.ini next to the settings file.
+// Only answers that hash to their verification string are stored.
+class CapsCache
+{
+public:
+    static CapsCache *instance();
+
+    bool contains(const QString &ver) const;
+    bool hasFeature(const QString &ver, const QString &feature) const;
+    void insert(const QString &ver, const QStringList &features);
+
+    // base64 SHA-1 over identities and features as XEP-0115 section 5.1
+    // describes; extended info forms are not covered
+    static QString verificationString(const QXmppDiscoveryIq &iq);
+
+private:
+    CapsCache();
+    void load();
+    void save() const;
+
+    QString m_fileName;
+    QHash<QString, QSet<QString> > m_features; // <ver, features>
+};
+
+#endif // CAPSCACHE_H
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "CapsTracker.h"
+#include "CapsCache.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <QXmppClient.h>
+#include <QXmppDiscoveryIq.h>
+#include <QXmppPresence.h>
+#include <QXmppUtils.h>
+#include <QTimer>
+
+static const int QueryTimeout = 30000;
+
+CapsTracker::CapsTracker(QXmppClient *client, QObject *parent) :
+    QObject(parent),
+    m_client(client),
+    m_expireTimer(new QTimer(this))
+{
+    m_clock.start();
+    m_expireTimer->setSingleShot(true);
+    m_expireTimer->setInterval(QueryTimeout);
+
+    connect(m_client, SIGNAL(presenceReceived(QXmppPresence)),
+            this, SLOT(presenceReceived(QXmppPresence)) );
+    connect(m_client, SIGNAL(discoveryIqReceived(QXmppDiscoveryIq)),
+            this, SLOT(discoveryIqReceived(QXmppDiscoveryIq)) );
+    connect(m_client, SIGNAL(disconnected()),
+            this, SLOT(clear()) );
+    connect(m_expireTimer, SIGNAL(timeout()),
+            this, SLOT(expireQueries()) );
+}
+
+CapsTracker::Support CapsTracker::supports(const QString &jid, const QString &feature) const
+{
+    if (!jidToResource(jid).isEmpty())
+        return resourceSupports(jid, feature);
+
+    // a bare jid supports what any of its resources supports
+    Support support = Unknown;
+    foreach (const QString &resource, m_resources.value(jid)) {
+        Support each = resourceSupports(jid + "/" + resource, feature);
+        if (each == Supported)
+            return Supported;
+        if (each == Unsupported)
+            support = Unsupported;
+    }
+    return support;
+}
+
+CapsTracker::Support CapsTracker::resourceSupports(const QString &jid, const QString &feature) const
+{
+    QHash<QString, QString>::const_iterator ver = m_vers.constFind(jid);
+    if (ver == m_vers.constEnd())
+        return Unknown;
+
+    CapsCache *cache = CapsCache::instance();
+    if (cache->contains(ver.value()))
+        return cache->hasFeature(ver.value(), feature) ? Supported : Unsupported;
+
+    QHash<QString, QSet<QString> >::const_iterator features = m_unverified.constFind(jid);
+    if (features != m_unverified.constEnd())
+        return features.value().contains(feature) ? Supported : Unsupported;
+    return Unknown;
+}
+
+void CapsTracker::presenceReceived(const QXmppPresence &presence)
+{
+    QString jid = presence.from();
+    if (jidToResource(jid).isEmpty())
+        return;
+    if (presence.getType() == QXmppPresence::Unavailable) {
+        forget(jid);
+        return;
+    }
+    if (presence.getType() != QXmppPresence::Available || presence.capabilityVer().isEmpty())
+        return;
+
+    // the library hands over the decoded digest
+    QString ver = QString::fromAscii(presence.capabilityVer().toBase64());
+    if (m_vers.value(jid) == ver)
+        return;
+    m_vers.insert(jid, ver);
+    m_resources[jidToBareJid(jid)].insert(jidToResource(jid));
+    m_unverified.remove(jid);
+
+    static qint64 &hits = Metrics::counter("caps.hit");
+    static qint64 &misses = Metrics::counter("caps.miss");
+    if (CapsCache::instance()->contains(ver)) {
+        hits++;
+        return;
+    }
+    misses++;
+    QHash<QString, QSet<QString> >::iterator waiting = m_waiting.find(ver);
+    if (waiting != m_waiting.end()) {
+        waiting.value().insert(jid);
+        return;
+    }
+    m_waiting[ver].insert(jid);
+    query(ver, presence.capabilityNode() + "#" + ver, jid);
+}
+
+void CapsTracker::query(const QString &ver, const QString &node, const QString &jid)
+{
+    QXmppDiscoveryIq info;
+    info.setType(QXmppIq::Get);
+    info.setQueryType(QXmppDiscoveryIq::InfoQuery);
+    info.setTo(jid);
+    info.setQueryNode(node);
+
+    Query query;
+    query.ver = ver;
+    query.node = node;
+    query.jid = jid;
+    query.sentAt = m_clock.elapsed();
+    m_queries.insert(info.id(), query);
+    m_client->sendPacket(info);
+
+    if (!m_expireTimer->isActive())
+        m_expireTimer->start();
+}
+
+// asks the next resource still announcing the string, or gives up on it
+// until it is announced again
+void CapsTracker::retry(const Query &failed)
+{
+    QSet<QString> &waiting = m_waiting[failed.ver];
+    waiting.remove(failed.jid);
+    foreach (const QString &jid, waiting) {
+        if (m_vers.value(jid) == failed.ver) {
+            query(failed.ver, failed.node, jid);
+            return;
+        }
+    }
+    m_waiting.remove(failed.ver);
+}
+
+void CapsTracker::discoveryIqReceived(const QXmppDiscoveryIq &iq)
+{
+    QHash<QString, Query>::iterator it = m_queries.find(iq.id());
+    if (it == m_queries.end())
+        return;
+
+    Query query = it.value();
+    m_queries.erase(it);
+    if (iq.type() != QXmppIq::Result) {
+        retry(query);
+        return;
+    }
+
+    QSet<QString> waiting = m_waiting.take(query.ver);
+    if (CapsCache::verificationString(iq) == query.ver) {
+        CapsCache::instance()->insert(query.ver, iq.features());
+    } else {
+        // legacy caps, forms or a lying client: good for the resources that
+        // announced the same string, not for the cache
+        LOG_INFO(QString("[CapsTracker] %1 does not match its caps %2").arg(iq.from()).arg(query.ver));
+        QSet<QString> features = iq.features().toSet();
+        foreach (const QString &jid, waiting) {
+            if (m_vers.value(jid) == query.ver)
+                m_unverified.insert(jid, features);
+        }
+    }
+}
+
+void CapsTracker::expireQueries()
+{
+    qint64 now = m_clock.elapsed();
+    QList<Query> expired;
+    QHash<QString, Query>::iterator it = m_queries.begin();
+    while (it != m_queries.end()) {
+        if (now - it.value().sentAt >= QueryTimeout) {
+            LOG_INFO(QString("[CapsTracker] %1 did not answer for caps %2").arg(it.value().jid).arg(it.value().ver));
+            expired << it.value();
+            it = m_queries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    foreach (const Query &query, expired) {
+        retry(query);
+    }
+    if (!m_queries.isEmpty())
+        m_expireTimer->start();
+}
+
+void CapsTracker::clear()
+{
+    m_vers.clear();
+    m_resources.clear();
+    m_unverified.clear();
+    m_queries.clear();
+    m_waiting.clear();
+    m_expireTimer->stop();
+}
+
+void CapsTracker::forget(const QString &jid)
+{
+    m_vers.remove(jid);
+    m_unverified.remove(jid);
+    QString bareJid = jidToBareJid(jid);
+    QHash<QString, QSet<QString> >::iterator it = m_resources.find(bareJid);
+    if (it != m_resources.end()) {
+        it.value().remove(jidToResource(jid));
+        if (it.value().isEmpty())
+            m_resources.erase(it);
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CAPSTRACKER_H
+#define CAPSTRACKER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+
+class QTimer;
+class QXmppClient;
+class QXmppDiscoveryIq;
+class QXmppPresence;
+
+// What the resources of one account's contacts support, from the XEP-0115
+// caps in their presence. A verification string the CapsCache does not
+// know yet is asked for once with disco#info, whoever announced it first;
+// feature checks never wait for the network. An answer that does not
+// match its hash is only used for the resources that announced the string
+// while it was asked for. When no answer comes, the next of them is asked.
+class CapsTracker : public QObject
+{
+    Q_OBJECT
+public:
+    enum Support
+    {
+        Unknown = 0, // no caps, or the answer is still out
+        Supported,
+        Unsupported
+    };
+
+    explicit CapsTracker(QXmppClient *client, QObject *parent = 0);
+    Support supports(const QString &jid, const QString &feature) const; // full or bare jid
+
+private slots:
+    void presenceReceived(const QXmppPresence &presence);
+    void discoveryIqReceived(const QXmppDiscoveryIq &iq);
+    void expireQueries();
+    void clear();
+
+private:
+    struct Query
+    {
+        QString ver;
+        QString node; // node#ver
+        QString jid; // full jid asked
+        qint64 sentAt; // m_clock msecs
+    };
+
+    QXmppClient *m_client;
+    QHash<QString, QString> m_vers; // <full jid, ver>
+    QHash<QString, QSet<QString> > m_resources; // <bare jid, resources with caps>
+    QHash<QString, QSet<QString> > m_unverified; // <full jid, features>
+    QHash<QString, Query> m_queries; // <iq id, query>
+    QHash<QString, QSet<QString> > m_waiting; // <ver asked for, full jids announcing it>
+    QElapsedTimer m_clock;
+    QTimer *m_expireTimer;
+
+    Support resourceSupports(const QString &jid, const QString &feature) const;
+    void query(const QString &ver, const QString &node, const QString &jid);
+    void retry(const Query &failed);
+    void forget(const QString &jid);
+};
+
+#endif // CAPSTRACKER_H
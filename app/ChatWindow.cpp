@@ -31,6 +31,8 @@
 #include <QTime>
 #include <QDomDocument>
 #include "XmppMessage.h"
+#include "XhtmlIm.h"
+#include "CapsTracker.h"
 #include <QXmppRoster.h>
 #include <QCloseEvent>
 #include <QTimer>
@@ -41,21 +43,50 @@
 #include <QFileDialog>
 #include <QDesktopServices>
 #include <QXmppRpcIq.h>
+#include <QScrollBar>
+#include <QClipboard>
+#include <QApplication>
+#include <QTextDocument>
+#include "MessageModel.h"
+#include "MessageDelegate.h"
+#include "Outbox.h"
+#include "Metrics.h"
 
-ChatWindow::ChatWindow(QString jid, QXmppClient *client, QWidget *parent) :
+ChatWindow::ChatWindow(QString jid, QXmppClient *client, Outbox *outbox,
+                       CapsTracker *capsTracker, QWidget *parent) :
     QMainWindow(parent),
     m_jid(jid),
     m_client(client),
+    m_outbox(outbox),
+    m_capsTracker(capsTracker),
     m_selfState(QXmppMessage::Active),
     m_pausedTimer(new QTimer),
     m_inactiveTimer(new QTimer),
     m_goneTimer(new QTimer),
     m_statusBar(new QStatusBar),
     m_sendButton(new QPushButton),
-    m_sendTip(new QLabel)
+    m_sendTip(new QLabel),
+    m_droppedNotice(new QLabel),
+    m_messageModel(new MessageModel(500, this))
 {
     ui.setupUi(this);
 
+    ui.messageView->setModel(m_messageModel);
+    ui.messageView->setItemDelegate(new MessageDelegate(ui.messageView, this));
+    ui.messageView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    ui.messageView->setResizeMode(QListView::Adjust);
+    ui.messageView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    ui.messageView->setUniformItemSizes(false);
+
+    QAction *copyAction = new QAction(this);
+    copyAction->setShortcut(QKeySequence::Copy);
+    copyAction->setShortcutContext(Qt::WidgetShortcut);
+    ui.messageView->addAction(copyAction);
+    connect(copyAction, SIGNAL(triggered()),
+            this, SLOT(copySelectedMessages()) );
+    connect(m_messageModel, SIGNAL(droppedCountChanged(int)),
+            this, SLOT(showDroppedCount(int)) );
+
     setWindowTitle(QString(tr("Contact: %1")).arg(m_jid));
 
     m_editor = new MessageEdit();
@@ -67,6 +98,9 @@ ChatWindow::ChatWindow(QString jid, QXmppClient *client, QWidget *parent) :
 
     m_sendButton->setText(tr("Send"));
     m_sendButton->setFixedHeight(m_statusBar->sizeHint().height());
+    m_droppedNotice->hide();
+    m_droppedNotice->setToolTip(tr("The number of messages kept can be raised in the preferences"));
+    m_statusBar->addWidget(m_droppedNotice);
     m_statusBar->addPermanentWidget(m_sendTip);
     m_statusBar->addPermanentWidget(m_sendButton);
     m_statusBar->setSizeGripEnabled(false);
@@ -108,12 +142,10 @@ void ChatWindow::appendMessage(const QXmppMessage &o_message)
     changeState(message.state());
     if (!message.body().isEmpty()){
         //QString bareJid = jidToBareJid(message.from()); 
-        ui.messageBrowser->append(QString("%1 %2").arg(message.from()).arg(QTime::currentTime().toString()));
-        if (message.html().isEmpty()) {
-            ui.messageBrowser->append(message.body());
-        } else {
-            ui.messageBrowser->append(message.html());
-        }
+        QString html = message.html();
+        if (html.isEmpty())
+            html = Qt::escape(message.body()).replace('\n', "<br/>");
+        appendToView(message.from(), html);
 
         if (!isActiveWindow()) {
             // notice new message
@@ -133,6 +165,13 @@ void ChatWindow::readPref(Preferences *pref)
         m_sendTip->setText("Ctrl+Enter");
     }
     m_editor->setIgnoreEnter(pref->enterToSendMessage);
+    m_messageModel->setMaxMessages(pref->chatScrollback);
+}
+
+void ChatWindow::showDroppedCount(int count)
+{
+    m_droppedNotice->setText(tr("%n older message(s) no longer shown", "", count));
+    m_droppedNotice->setVisible(count > 0);
 }
 
 void ChatWindow::setVCard(QXmppVCard vCard)
@@ -144,21 +183,39 @@ void ChatWindow::setVCard(QXmppVCard vCard)
 
 void ChatWindow::sendMessage()
 {
-    if (m_editor->toPlainText().isEmpty())
+    QString text = m_editor->toPlainText();
+    if (text.isEmpty())
         return;
     XmppMessage message(m_client->getConfiguration().jid(),
                         m_jid,
-                        m_editor->toPlainText());
-    message.setHtml(m_editor->toHtml());
-    m_client->sendPacket(message);
+                        text);
+    // only attach the XHTML-IM part when the text is actually formatted,
+    // and not to a client known to drop it
+    bool formatted = false;
+    QString body = XhtmlIm::encode(m_editor->document(), &formatted);
+    if (formatted && m_capsTracker->supports(m_jid, "http://jabber.org/protocol/xhtml-im")
+            != CapsTracker::Unsupported)
+        message.setHtml(XhtmlIm::wrap(body));
+    m_outbox->sendMessage(message);
 
     QString c_bareJid = m_client->getConfiguration().jidBare();
-    ui.messageBrowser->append(QString("%1 %2").arg(c_bareJid).arg(QTime::currentTime().toString()));
-    ui.messageBrowser->append(m_editor->toHtml());
+    appendToView(c_bareJid, body);
     m_editor->clear();
     m_selfState = QXmppMessage::Active;
 }
 
+void ChatWindow::appendToView(const QString &from, const QString &html)
+{
+    // follow the conversation only if the user has not scrolled back
+    QScrollBar *scrollBar = ui.messageView->verticalScrollBar();
+    bool atBottom = scrollBar->value() == scrollBar->maximum();
+
+    m_messageModel->appendMessage(from, QTime::currentTime(), html);
+
+    if (atBottom)
+        ui.messageView->scrollToBottom();
+}
+
 void ChatWindow::changeState(QXmppMessage::State state)
 {
     QString stateStr;
@@ -199,6 +256,8 @@ void ChatWindow::sendComposing()
 
 void ChatWindow::changeSelfState(QXmppMessage::State state)
 {
+    static qint64 &sent = Metrics::counter("stanza.out.message");
+
     if (m_selfState != state) {
         m_selfState = state;
 
@@ -211,11 +270,13 @@ void ChatWindow::changeSelfState(QXmppMessage::State state)
             // if breaJid at less have one resource
             if (!m_client->getRoster().getAllPresencesForBareJid(bareJid).isEmpty()) {
                 m_client->sendPacket(message);
+                sent++;
             }
         } else {
             // if resource no unavable
             if (!m_client->getRoster().getPresence(bareJid, resource).from().isEmpty()) {
                 m_client->sendPacket(message);
+                sent++;
             }
         }
     }
@@ -270,3 +331,17 @@ void ChatWindow::sendFileSlot()
         return;
     emit sendFile(m_jid, fileName);
 }
+
+void ChatWindow::copySelectedMessages()
+{
+    QModelIndexList indexes = ui.messageView->selectionModel()->selectedRows();
+    if (indexes.isEmpty())
+        return;
+
+    qSort(indexes);
+    QStringList texts;
+    foreach (QModelIndex index, indexes) {
+        texts << m_messageModel->plainTextAt(index);
+    }
+    QApplication::clipboard()->setText(texts.join("\n"));
+}
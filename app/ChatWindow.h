@@ -42,12 +42,16 @@ class QPushButton;
 class MessageEdit;
 class QXmppVCard;
 class ContactInfoDialog;
+class MessageModel;
+class Outbox;
+class CapsTracker;
 
 class ChatWindow : public QMainWindow
 {
     Q_OBJECT
 public:
-    ChatWindow(QString jid, QXmppClient *client, QWidget *parent = 0);
+    ChatWindow(QString jid, QXmppClient *client, Outbox *outbox,
+               CapsTracker *capsTracker, QWidget *parent = 0);
     void appendMessage(const QXmppMessage &);
     void readPref(Preferences *pref);
     void setVCard(QXmppVCard vCard);
@@ -64,6 +68,8 @@ private slots:
     void goneTimeout();
     void openContactInfoDialog();
     void sendFileSlot();
+    void copySelectedMessages();
+    void showDroppedCount(int count);
 
 protected:
     void closeEvent(QCloseEvent *);
@@ -73,6 +79,8 @@ private:
     Ui::ChatWindow ui;
     QString m_jid;
     QXmppClient *m_client;
+    Outbox *m_outbox;
+    CapsTracker *m_capsTracker;
     QXmppMessage::State m_selfState; // self state, se for send state message
     QTimer *m_pausedTimer;
     QTimer *m_inactiveTimer;
@@ -81,10 +89,13 @@ private:
     QStatusBar *m_statusBar;
     QPushButton *m_sendButton;
     QLabel *m_sendTip;
+    QLabel *m_droppedNotice;
     QXmppVCard m_vCard;
     QPointer<ContactInfoDialog> m_contactInfoDialog;
+    MessageModel *m_messageModel;
 
     void changeState(QXmppMessage::State);
+    void appendToView(const QString &from, const QString &html);
     void changeSelfState(QXmppMessage::State);
 };
 #endif
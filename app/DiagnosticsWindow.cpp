@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "DiagnosticsWindow.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "StartupTrace.h"
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTimer>
+#include <QVBoxLayout>
+
+DiagnosticsWindow::DiagnosticsWindow(QWidget *parent) :
+    QWidget(parent, Qt::Window),
+    m_text(new QPlainTextEdit(this)),
+    m_timer(new QTimer(this)),
+    m_lastTransferBytes(0)
+{
+    setWindowTitle(tr("Diagnostics"));
+    resize(520, 480);
+
+    m_text->setReadOnly(true);
+    m_text->setLineWrapMode(QPlainTextEdit::NoWrap);
+    QFont font("Monospace");
+    font.setStyleHint(QFont::TypeWriter);
+    m_text->setFont(font);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_text);
+    layout->setMargin(0);
+
+    m_timer->setInterval(1000);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(refresh()) );
+}
+
+void DiagnosticsWindow::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    m_elapsed.start();
+    m_lastTransferBytes = Metrics::counter("transfer.bytes");
+    refresh();
+    m_timer->start();
+}
+
+void DiagnosticsWindow::hideEvent(QHideEvent *event)
+{
+    // nothing is computed while nobody looks
+    m_timer->stop();
+    QWidget::hideEvent(event);
+}
+
+void DiagnosticsWindow::refresh()
+{
+    qint64 transferBytes = Metrics::counter("transfer.bytes");
+    qint64 msecs = qMax(Q_INT64_C(1), m_elapsed.restart());
+    qint64 rate = (transferBytes - m_lastTransferBytes) * 1000 / msecs;
+    m_lastTransferBytes = transferBytes;
+
+    QStringList lines = Metrics::report();
+    lines << QString() << QString("transfer throughput = %1 B/s").arg(rate);
+    lines << QString("log messages dropped = %1").arg(Logger::droppedCount());
+    lines << QString() << tr("Startup:") << StartupTrace::report();
+
+    int scroll = m_text->verticalScrollBar()->value();
+    m_text->setPlainText(lines.join("\n"));
+    m_text->verticalScrollBar()->setValue(scroll);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DIAGNOSTICSWINDOW_H
+#define DIAGNOSTICSWINDOW_H
+
+#include <QWidget>
+#include <QElapsedTimer>
+
+class QPlainTextEdit;
+class QTimer;
+
+// Live view of the metrics registry, opened with Ctrl+Shift+D.
+class DiagnosticsWindow : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DiagnosticsWindow(QWidget *parent = 0);
+
+protected:
+    void showEvent(QShowEvent *event);
+    void hideEvent(QHideEvent *event);
+
+private slots:
+    void refresh();
+
+private:
+    QPlainTextEdit *m_text;
+    QTimer *m_timer;
+    QElapsedTimer m_elapsed;
+    qint64 m_lastTransferBytes;
+};
+
+#endif // DIAGNOSTICSWINDOW_H
@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "HeadlessClient.h"
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSocketNotifier>
+#include <QXmppLogger.h>
+#include <QXmppMessage.h>
+#include <QXmppRoster.h>
+#include "ReconnectScheduler.h"
+#include <stdio.h>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+HeadlessClient::HeadlessClient(QObject *parent) :
+    QObject(parent),
+    m_client(new QXmppClient(this)),
+    m_reconnectScheduler(new ReconnectScheduler(this)),
+    m_quitting(false),
+    m_stdinNotifier(0),
+    m_server(0)
+{
+}
+
+bool HeadlessClient::start(const QStringList &arguments)
+{
+    int account = arguments.indexOf("--account");
+    if (account > 0 && account + 1 < arguments.count())
+        m_preferences.account = arguments.at(account + 1).toInt();
+    m_preferences.load();
+
+    QString socketName;
+    for (int i = 1; i < arguments.count(); i++) {
+        const QString arg = arguments.at(i);
+        const QString value = i + 1 < arguments.count() ? arguments.at(i + 1) : QString();
+        if (arg == "--jid") {
+            m_preferences.jid = value;
+            i++;
+        } else if (arg == "--password") {
+            m_preferences.password = value;
+            i++;
+        } else if (arg == "--host") {
+            m_preferences.host = value;
+            i++;
+        } else if (arg == "--port") {
+            m_preferences.port = value.toInt();
+            i++;
+        } else if (arg == "--account") {
+            i++;
+        } else if (arg == "--socket") {
+            socketName = value;
+            i++;
+        }
+    }
+
+    // keep the password out of the process list if possible
+    QByteArray envPassword = qgetenv("QTALK_PASSWORD");
+    if (!envPassword.isEmpty())
+        m_preferences.password = QString::fromUtf8(envPassword);
+
+    if (m_preferences.jid.isEmpty()) {
+        fprintf(stderr, "qtalk: no account configured, use --jid and --password\n");
+        return false;
+    }
+    if (m_preferences.host.isEmpty()) {
+        m_preferences.host = m_preferences.jid.section('@', 1).section('/', 0, 0);
+        if (m_preferences.host == "gmail.com")
+            m_preferences.host = "talk.google.com";
+    }
+
+    // stdout carries the event stream, keep library logging away from it
+    QXmppLogger::getLogger()->setLoggingType(QXmppLogger::NONE);
+
+    m_client->getConfiguration().setAutoAcceptSubscriptions(false);
+
+    connect(m_client, SIGNAL(connected()),
+            this, SLOT(clientConnected()) );
+    connect(m_client, SIGNAL(disconnected()),
+            this, SLOT(clientDisconnected()) );
+    connect(m_client, SIGNAL(error(QXmppClient::Error)),
+            this, SLOT(clientError(QXmppClient::Error)) );
+    connect(m_client, SIGNAL(messageReceived(QXmppMessage)),
+            this, SLOT(messageReceived(QXmppMessage)) );
+    connect(m_client, SIGNAL(presenceReceived(QXmppPresence)),
+            this, SLOT(presenceReceived(QXmppPresence)) );
+    connect(&m_client->getRoster(), SIGNAL(presenceChanged(const QString, const QString)),
+            this, SLOT(presenceChanged(const QString, const QString)) );
+    connect(&m_client->getRoster(), SIGNAL(rosterChanged(QString)),
+            this, SLOT(rosterChanged(QString)) );
+    connect(m_reconnectScheduler, SIGNAL(reconnect()),
+            this, SLOT(reconnect()) );
+
+#ifdef Q_OS_UNIX
+    m_stdinNotifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+    connect(m_stdinNotifier, SIGNAL(activated(int)),
+            this, SLOT(stdinReadyRead()) );
+#endif
+
+    if (!socketName.isEmpty()) {
+        m_server = new QLocalServer(this);
+        QLocalServer::removeServer(socketName);
+        if (!m_server->listen(socketName)) {
+            fprintf(stderr, "qtalk: can not listen on %s\n", qPrintable(socketName));
+            return false;
+        }
+        connect(m_server, SIGNAL(newConnection()),
+                this, SLOT(newSocketConnection()) );
+    }
+
+    m_client->connectToServer(m_preferences.host, m_preferences.jid,
+                              m_preferences.password, m_preferences.port);
+    return true;
+}
+
+void HeadlessClient::clientConnected()
+{
+    m_reconnectScheduler->reset();
+    writeEvent("connected");
+}
+
+void HeadlessClient::clientDisconnected()
+{
+    writeEvent("disconnected");
+    if (!m_quitting)
+        m_reconnectScheduler->schedule();
+}
+
+void HeadlessClient::clientError(QXmppClient::Error error)
+{
+    writeEvent(QString("error %1").arg(int(error)));
+    if (!m_quitting)
+        m_reconnectScheduler->schedule();
+}
+
+void HeadlessClient::reconnect()
+{
+    m_client->connectToServer(m_preferences.host, m_preferences.jid,
+                              m_preferences.password, m_preferences.port);
+}
+
+void HeadlessClient::messageReceived(const QXmppMessage &message)
+{
+    // ignore state message
+    if (message.body().isEmpty())
+        return;
+    writeEvent(QString("message %1 %2").arg(message.from(), escape(message.body())));
+}
+
+void HeadlessClient::presenceReceived(const QXmppPresence &presence)
+{
+    if (presence.getType() == QXmppPresence::Subscribe)
+        writeEvent(QString("subscribe %1").arg(presence.from()));
+}
+
+void HeadlessClient::presenceChanged(const QString &bareJid, const QString &resource)
+{
+    QXmppPresence presence = m_client->getRoster().getPresence(bareJid, resource);
+    QString jid = bareJid + "/" + resource;
+    if (presence.from().isEmpty()) {
+        writeEvent(QString("presence %1 unavailable").arg(jid));
+    } else {
+        QString status = presence.getStatus().getTypeStr();
+        if (!presence.getStatus().getStatusText().isEmpty())
+            status += " " + escape(presence.getStatus().getStatusText());
+        writeEvent(QString("presence %1 available %2").arg(jid, status).trimmed());
+    }
+}
+
+void HeadlessClient::rosterChanged(const QString &bareJid)
+{
+    writeRosterEntry(bareJid, 0);
+    foreach (QLocalSocket *socket, m_sockets)
+        writeRosterEntry(bareJid, socket);
+}
+
+void HeadlessClient::stdinReadyRead()
+{
+#ifdef Q_OS_UNIX
+    char buffer[4096];
+    ssize_t size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (size <= 0) {
+        // stdin closed, keep running only if someone can still talk to us
+        m_stdinNotifier->setEnabled(false);
+        if (m_server == 0)
+            qApp->quit();
+        return;
+    }
+
+    m_stdinBuffer.append(buffer, size);
+    int pos;
+    while ((pos = m_stdinBuffer.indexOf('\n')) >= 0) {
+        QString line = QString::fromUtf8(m_stdinBuffer.left(pos)).trimmed();
+        m_stdinBuffer.remove(0, pos + 1);
+        if (!line.isEmpty())
+            handleCommand(line, 0);
+    }
+#endif
+}
+
+void HeadlessClient::newSocketConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        m_sockets << socket;
+        connect(socket, SIGNAL(readyRead()),
+                this, SLOT(socketReadyRead()) );
+        connect(socket, SIGNAL(disconnected()),
+                this, SLOT(socketDisconnected()) );
+    }
+}
+
+void HeadlessClient::socketReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    while (socket->canReadLine()) {
+        QString line = QString::fromUtf8(socket->readLine()).trimmed();
+        if (!line.isEmpty())
+            handleCommand(line, socket);
+    }
+}
+
+void HeadlessClient::socketDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    m_sockets.removeAll(socket);
+    socket->deleteLater();
+}
+
+void HeadlessClient::handleCommand(const QString &line, QIODevice *replyTo)
+{
+    QString command = line.section(' ', 0, 0);
+    QString jid = line.section(' ', 1, 1);
+    QString text = line.section(' ', 2);
+
+    if (command == "send" && !jid.isEmpty()) {
+        QXmppMessage message(m_client->getConfiguration().jid(), jid,
+                             unescape(text));
+        m_client->sendPacket(message);
+    } else if (command == "presence") {
+        // here the second word is the presence type
+        QXmppPresence presence = m_client->getClientPresence();
+        if (jid == "online")
+            presence.getStatus().setType(QXmppPresence::Status::Online);
+        else if (jid == "chat")
+            presence.getStatus().setType(QXmppPresence::Status::Chat);
+        else if (jid == "away")
+            presence.getStatus().setType(QXmppPresence::Status::Away);
+        else if (jid == "xa")
+            presence.getStatus().setType(QXmppPresence::Status::XA);
+        else if (jid == "dnd")
+            presence.getStatus().setType(QXmppPresence::Status::DND);
+        else {
+            writeLine(replyTo, "error unknown presence");
+            return;
+        }
+        presence.getStatus().setStatusText(unescape(text));
+        m_client->setClientPresence(presence);
+    } else if ((command == "accept" || command == "reject") && !jid.isEmpty()) {
+        QXmppPresence presence(command == "accept" ? QXmppPresence::Subscribed
+                                                   : QXmppPresence::Unsubscribed);
+        presence.setTo(jid);
+        m_client->sendPacket(presence);
+    } else if (command == "roster") {
+        foreach (QString bareJid, m_client->getRoster().getRosterBareJids()) {
+            writeRosterEntry(bareJid, replyTo);
+        }
+    } else if (command == "quit") {
+        m_quitting = true;
+        m_reconnectScheduler->cancel();
+        m_client->disconnect();
+        qApp->quit();
+    } else {
+        writeLine(replyTo, "error unknown command");
+        return;
+    }
+    writeLine(replyTo, "ok");
+}
+
+void HeadlessClient::writeEvent(const QString &event)
+{
+    writeLine(0, event);
+    foreach (QLocalSocket *socket, m_sockets)
+        writeLine(socket, event);
+}
+
+void HeadlessClient::writeLine(QIODevice *device, const QString &line)
+{
+    QByteArray data = line.toUtf8() + '\n';
+    if (device) {
+        device->write(data);
+    } else {
+        fwrite(data.constData(), 1, data.size(), stdout);
+        fflush(stdout);
+    }
+}
+
+void HeadlessClient::writeRosterEntry(const QString &bareJid, QIODevice *replyTo)
+{
+    QXmppRoster::QXmppRosterEntry entry = m_client->getRoster().getRosterEntry(bareJid);
+    QString subscription;
+    switch (entry.subscriptionType()) {
+    case QXmppRoster::QXmppRosterEntry::None:
+        subscription = "none";
+        break;
+    case QXmppRoster::QXmppRosterEntry::Both:
+        subscription = "both";
+        break;
+    case QXmppRoster::QXmppRosterEntry::From:
+        subscription = "from";
+        break;
+    case QXmppRoster::QXmppRosterEntry::To:
+        subscription = "to";
+        break;
+    case QXmppRoster::QXmppRosterEntry::Remove:
+        subscription = "remove";
+        break;
+    default:
+        subscription = "notset";
+        break;
+    }
+    writeLine(replyTo, QString("roster %1 %2 %3").arg(bareJid, subscription,
+              escape(entry.name())).trimmed());
+}
+
+QString HeadlessClient::escape(const QString &text)
+{
+    QString result = text;
+    result.replace("\\", "\\\\");
+    result.replace("\n", "\\n");
+    result.remove('\r');
+    return result;
+}
+
+QString HeadlessClient::unescape(const QString &text)
+{
+    // one pass, so "\\n" is a backslash then n, not a backslash and a newline
+    QString result;
+    result.reserve(text.length());
+    for (int i = 0; i < text.length(); i++) {
+        QChar c = text.at(i);
+        if (c == '\\' && i + 1 < text.length()) {
+            QChar next = text.at(++i);
+            if (next == 'n')
+                result += '\n';
+            else if (next == '\\')
+                result += '\\';
+            else
+                result += QString(c) + next; // not an escape, kept as it is
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
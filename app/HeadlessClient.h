@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HEADLESSCLIENT_H
+#define HEADLESSCLIENT_H
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QXmppClient.h>
+#include "Preferences.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QSocketNotifier;
+class QXmppMessage;
+class QXmppPresence;
+class ReconnectScheduler;
+
+// Run the client core without any widget. Commands are read line by line
+// from stdin and from an optional local socket, events are written back to
+// stdout and to every connected socket.
+//
+// commands:
+//   send <jid> <text>
+//   presence <online|chat|away|xa|dnd> [status text]
+//   accept <jid> | reject <jid>
+//   roster
+//   quit
+// events:
+//   connected | disconnected | error <code>
+//   message <from> <body>
+//   presence <jid> <available|unavailable> [status text]
+//   subscribe <jid>
+//   roster <bareJid> <subscription> [name]
+// Text is one line: a newline is written as \n and a backslash as \\, in
+// both directions.
+class HeadlessClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeadlessClient(QObject *parent = 0);
+    bool start(const QStringList &arguments);
+
+private slots:
+    void clientConnected();
+    void clientDisconnected();
+    void clientError(QXmppClient::Error error);
+    void messageReceived(const QXmppMessage &message);
+    void presenceReceived(const QXmppPresence &presence);
+    void presenceChanged(const QString &bareJid, const QString &resource);
+    void rosterChanged(const QString &bareJid);
+    void stdinReadyRead();
+    void newSocketConnection();
+    void socketReadyRead();
+    void socketDisconnected();
+    void reconnect();
+
+private:
+    Preferences m_preferences;
+    QXmppClient *m_client;
+    ReconnectScheduler *m_reconnectScheduler;
+    bool m_quitting;
+    QSocketNotifier *m_stdinNotifier;
+    QByteArray m_stdinBuffer;
+    QLocalServer *m_server;
+    QList<QLocalSocket *> m_sockets;
+
+    void handleCommand(const QString &line, QIODevice *replyTo);
+    void writeEvent(const QString &event);
+    void writeLine(QIODevice *device, const QString &line);
+    void writeRosterEntry(const QString &bareJid, QIODevice *replyTo);
+    static QString escape(const QString &text);
+    static QString unescape(const QString &text);
+};
+
+#endif // HEADLESSCLIENT_H
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IconCache.h"
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+
+static QHash<QString, QIcon> &icons()
+{
+    static QHash<QString, QIcon> hash;
+    return hash;
+}
+
+QIcon IconCache::icon(const QString &fileName)
+{
+    QHash<QString, QIcon>::const_iterator it = icons().constFind(fileName);
+    if (it != icons().constEnd())
+        return it.value();
+
+    QIcon result(fileName);
+    icons().insert(fileName, result);
+    return result;
+}
+
+QIcon IconCache::scaledIcon(const QString &fileName, const QSize &size)
+{
+    QString key = QString("%1@%2x%3").arg(fileName).arg(size.width()).arg(size.height());
+    QHash<QString, QIcon>::const_iterator it = icons().constFind(key);
+    if (it != icons().constEnd())
+        return it.value();
+
+    QImage image(fileName);
+    QIcon result(QPixmap::fromImage(image.scaled(size)));
+    icons().insert(key, result);
+    return result;
+}
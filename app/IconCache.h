@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QIcon>
+#include <QSize>
+
+// Icons built from the resource images, loaded once for the whole process.
+class IconCache
+{
+public:
+    static QIcon icon(const QString &fileName);
+    static QIcon scaledIcon(const QString &fileName, const QSize &size);
+};
+
+#endif // ICONCACHE_H
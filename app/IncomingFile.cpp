@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IncomingFile.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <QAbstractSocket>
+#include <QCryptographicHash>
+#include <QThread>
+#include <QXmppTransferManager.h>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/falloc.h>
+#endif
+
+// how far the writer thread may fall behind the network
+static const qint64 MaxBuffered = 16 * 1024 * 1024;
+// how much a paused socket may still take from the kernel
+static const qint64 PausedReadBuffer = 4096;
+
+class IncomingFileWriter : public QThread
+{
+public:
+    IncomingFileWriter(IncomingFile *file) : m_file(file) {}
+
+protected:
+    void run()
+    {
+        IncomingFile *file = m_file;
+        for (;;) {
+            file->m_mutex.lock();
+            while (file->m_chunks.isEmpty() && !file->m_closing) {
+                file->m_notEmpty.wait(&file->m_mutex);
+            }
+            if (file->m_chunks.isEmpty()) {
+                file->m_mutex.unlock();
+                return;
+            }
+            QByteArray chunk = file->m_chunks.dequeue();
+            file->m_mutex.unlock();
+
+            bool written = file->writeChunk(chunk);
+
+            file->m_mutex.lock();
+            file->m_buffered -= chunk.size();
+            if (!written)
+                file->m_failed = true;
+            // resume once half the backlog is on disk, not at every chunk
+            if (file->m_paused && (file->m_buffered <= MaxBuffered / 2 || file->m_failed)) {
+                file->m_paused = false;
+                QMetaObject::invokeMethod(file, "resumeSource", Qt::QueuedConnection);
+            }
+            file->m_mutex.unlock();
+        }
+    }
+
+private:
+    IncomingFile *m_file;
+};
+
+IncomingFile::IncomingFile(const QString &fileName, QObject *parent) :
+    QIODevice(parent),
+    m_file(fileName + ".part"),
+    m_fileName(fileName),
+    m_size(0),
+    m_position(0),
+    m_digest(QCryptographicHash::Md5),
+    m_matched(false),
+    m_writer(0),
+    m_buffered(0),
+    m_closing(false),
+    m_failed(false),
+    m_paused(false)
+{
+}
+
+IncomingFile::~IncomingFile()
+{
+    close();
+}
+
+bool IncomingFile::open(qint64 size, const QByteArray &hash)
+{
+    m_size = size;
+    m_hash = hash;
+
+    // a part file left by an earlier attempt is written again from the start
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+    m_position = 0;
+    m_digest.reset();
+    m_matched = false;
+    preallocate();
+
+    m_buffered = 0;
+    m_closing = false;
+    m_failed = false;
+    m_paused = false;
+    m_writer = new IncomingFileWriter(this);
+    m_writer->start();
+    return QIODevice::open(QIODevice::WriteOnly);
+}
+
+void IncomingFile::setSource(QXmppTransferJob *job)
+{
+    m_source = job;
+}
+
+void IncomingFile::preallocate()
+{
+#if defined(Q_OS_LINUX)
+    // one contiguous reservation instead of growing chunk by chunk, the
+    // size stays what was written so a cut transfer is seen as such
+    if (m_size > 0 && fallocate(m_file.handle(), FALLOC_FL_KEEP_SIZE, 0, m_size) != 0)
+        LOG_DEBUG(QString("[IncomingFile] %1: no preallocation").arg(m_fileName));
+#endif
+}
+
+void IncomingFile::stopWriter()
+{
+    if (m_writer == 0)
+        return;
+
+    m_mutex.lock();
+    m_closing = true;
+    m_notEmpty.wakeOne();
+    m_mutex.unlock();
+    m_writer->wait();
+    delete m_writer;
+    m_writer = 0;
+}
+
+void IncomingFile::close()
+{
+    if (!isOpen())
+        return;
+    stopWriter();
+    if (m_socket)
+        resumeSource();
+    QIODevice::close();
+    m_file.close();
+}
+
+bool IncomingFile::isSequential() const
+{
+    return true;
+}
+
+QString IncomingFile::fileName() const
+{
+    return m_fileName;
+}
+
+qint64 IncomingFile::readData(char *, qint64)
+{
+    return -1;
+}
+
+qint64 IncomingFile::writeData(const char *data, qint64 size)
+{
+    bool pause = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_failed)
+            return -1;
+
+        m_chunks.enqueue(QByteArray(data, int(size)));
+        m_buffered += size;
+        m_notEmpty.wakeOne();
+        if (m_buffered >= MaxBuffered && !m_paused) {
+            m_paused = true;
+            pause = true;
+        }
+    }
+    if (pause)
+        pauseSource();
+    return size;
+}
+
+void IncomingFile::pauseSource()
+{
+    // backpressure: the job reads its socket on readyRead, so the socket
+    // stops being read until the writer has caught up
+    if (!m_socket && m_source)
+        m_socket = m_source->findChild<QAbstractSocket*>();
+    if (!m_socket) {
+        // in-band data comes through the XMPP stream, it cannot be paused
+        LOG_DEBUG(QString("[IncomingFile] %1: writer behind, no socket to pause").arg(m_fileName));
+        return;
+    }
+    m_socket->setReadBufferSize(PausedReadBuffer);
+    m_socket->blockSignals(true);
+    m_pausedFor.start();
+}
+
+void IncomingFile::resumeSource()
+{
+    if (!m_socket || !m_socket->signalsBlocked())
+        return;
+
+    static Histogram &paused = Metrics::histogram("transfer.backpressure");
+    paused.record(m_pausedFor.elapsed() * 1000);
+
+    m_socket->setReadBufferSize(0);
+    m_socket->blockSignals(false);
+    // what arrived meanwhile raised no signal
+    if (m_socket->bytesAvailable() > 0)
+        QMetaObject::invokeMethod(m_socket, "readyRead", Qt::QueuedConnection);
+}
+
+bool IncomingFile::writeChunk(const QByteArray &chunk)
+{
+    m_digest.addData(chunk);
+    if (m_file.write(chunk) != chunk.size()) {
+        LOG_ERROR(QString("[IncomingFile] %1: %2").arg(m_fileName, m_file.errorString()));
+        return false;
+    }
+    m_position += chunk.size();
+    return true;
+}
+
+bool IncomingFile::verify()
+{
+    // the digest followed the stream, no second pass over the file
+    m_matched = !m_hash.isEmpty() && m_digest.result() == m_hash;
+    return m_hash.isEmpty() || m_matched;
+}
+
+bool IncomingFile::hasChecksum() const
+{
+    return !m_hash.isEmpty();
+}
+
+bool IncomingFile::checksumMatched() const
+{
+    return m_matched;
+}
+
+bool IncomingFile::finish(bool completed)
+{
+    // everything queued reaches the disk first
+    stopWriter();
+    if (m_failed) {
+        setErrorString(m_file.errorString());
+        completed = false;
+    }
+    m_file.flush();
+    if (!completed || (m_size > 0 && m_position != m_size)) {
+        // the real name never holds a cut file
+        setErrorString(tr("Incomplete, the partial file is kept as %1").arg(m_file.fileName()));
+        close();
+        return false;
+    }
+
+    if (!verify()) {
+        LOG_WARNING(QString("[IncomingFile] %1: checksum mismatch").arg(m_fileName));
+        setErrorString(tr("Checksum mismatch"));
+        close();
+        m_file.remove();
+        return false;
+    }
+
+    close();
+    QFile::remove(m_fileName);
+    if (!m_file.rename(m_fileName)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+    return true;
+}
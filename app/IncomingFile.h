@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef INCOMINGFILE_H
+#define INCOMINGFILE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QQueue>
+#include <QWaitCondition>
+
+class QAbstractSocket;
+class QXmppTransferJob;
+class IncomingFileWriter;
+
+// Target of an incoming transfer. Data goes to "name.part", which is
+// renamed to the real name only once complete and verified against the
+// hash of the offer, so a failed transfer never leaves a cut file under the
+// real name. The part file is kept when a transfer dies; the sender always
+// starts from the first byte, so a new offer writes it again from the start.
+//
+// The disk is only touched from a writer thread: write() queues the chunk
+// and returns, the space for the whole file is reserved up front, and a
+// writer more than MaxBuffered behind pauses reading from the bytestream
+// socket of the source job until it has caught up; write() never waits.
+class IncomingFile : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit IncomingFile(const QString &fileName, QObject *parent = 0);
+    ~IncomingFile();
+
+    bool open(qint64 size, const QByteArray &hash);
+    void setSource(QXmppTransferJob *job);
+    void close();
+    bool isSequential() const;
+
+    QString fileName() const;
+    bool finish(bool completed);
+    bool hasChecksum() const; // the offer advertised a hash
+    bool checksumMatched() const; // valid after finish()
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private slots:
+    void resumeSource();
+
+private:
+    friend class IncomingFileWriter;
+
+    // owned by the writer thread between open() and finish()
+    QFile m_file;
+    QString m_fileName;
+    qint64 m_size;
+    QByteArray m_hash;
+    qint64 m_position;
+    QCryptographicHash m_digest; // of the stream, as it arrives
+    bool m_matched;
+
+    // shared with the writer thread
+    IncomingFileWriter *m_writer;
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QQueue<QByteArray> m_chunks;
+    qint64 m_buffered;
+    bool m_closing;
+    bool m_failed;
+    bool m_paused;
+
+    // GUI thread only
+    QPointer<QXmppTransferJob> m_source;
+    QPointer<QAbstractSocket> m_socket;
+    QElapsedTimer m_pausedFor;
+
+    void preallocate();
+    void stopWriter();
+    void pauseSource();
+    bool writeChunk(const QByteArray &chunk); // writer thread
+    bool verify();
+};
+
+#endif // INCOMINGFILE_H
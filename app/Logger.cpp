@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "Logger.h"
+#include "RotatingFile.h"
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSettings>
+#include <QThread>
+#include <cstdio>
+#include <cstdlib>
+
+int Logger::s_level = Logger::Warning;
+
+// bounded multi producer, single consumer queue. every cell carries the
+// position it may be used for next, so producers only race on one CAS.
+class LogRing
+{
+public:
+    enum { Size = 4096 }; // power of two
+
+    struct Cell
+    {
+        QAtomicInt sequence;
+        qint64 time;
+        int level;
+        QString text;
+    };
+
+    LogRing() : m_enqueuePos(0), m_dequeuePos(0), m_dropped(0)
+    {
+        for (int i = 0; i < Size; i++) {
+            m_cells[i].sequence = i;
+        }
+    }
+
+    bool push(qint64 time, int level, const QString &text)
+    {
+        int pos = m_enqueuePos;
+        for (;;) {
+            Cell &cell = m_cells[pos & (Size - 1)];
+            int diff = cell.sequence.fetchAndAddAcquire(0) - pos;
+            if (diff == 0) {
+                if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1)) {
+                    cell.time = time;
+                    cell.level = level;
+                    cell.text = text;
+                    cell.sequence.fetchAndStoreRelease(pos + 1);
+                    return true;
+                }
+            } else if (diff < 0) {
+                m_dropped.fetchAndAddRelaxed(1);
+                return false;
+            }
+            pos = m_enqueuePos;
+        }
+    }
+
+    // consumer thread only
+    bool pop(qint64 *time, int *level, QString *text)
+    {
+        Cell &cell = m_cells[m_dequeuePos & (Size - 1)];
+        if (cell.sequence.fetchAndAddAcquire(0) != m_dequeuePos + 1)
+            return false;
+
+        *time = cell.time;
+        *level = cell.level;
+        *text = cell.text;
+        cell.text.clear();
+        cell.sequence.fetchAndStoreRelease(m_dequeuePos + Size);
+        m_dequeuePos++;
+        return true;
+    }
+
+    int dropped() const
+    {
+        return m_dropped;
+    }
+
+private:
+    Cell m_cells[Size];
+    QAtomicInt m_enqueuePos;
+    int m_dequeuePos;
+    QAtomicInt m_dropped;
+};
+
+static LogRing &ring()
+{
+    static LogRing logRing;
+    return logRing;
+}
+
+class LogWriter : public QThread
+{
+public:
+    LogWriter(const QString &fileName) :
+        m_file(fileName, 2 * 1024 * 1024, 3),
+        m_running(1)
+    {
+    }
+
+    void stopWriting()
+    {
+        m_running = 0;
+    }
+
+protected:
+    void run()
+    {
+        while (m_running) {
+            if (!drain())
+                msleep(100);
+        }
+        drain();
+        m_file.close();
+    }
+
+private:
+    RotatingFile m_file;
+    QAtomicInt m_running;
+
+    bool drain()
+    {
+        static const char levelNames[] = "DIWE";
+        QByteArray lines;
+        qint64 time;
+        int level;
+        QString text;
+        while (ring().pop(&time, &level, &text)) {
+            lines += QDateTime::fromMSecsSinceEpoch(time).toString("yyyy-MM-dd hh:mm:ss.zzz").toLatin1();
+            lines += ' ';
+            lines += levelNames[qBound(0, level, 3)];
+            lines += ' ';
+            lines += text.toUtf8();
+            lines += '\n';
+        }
+        if (lines.isEmpty())
+            return false;
+
+        m_file.write(lines);
+        m_file.flush();
+        return true;
+    }
+};
+
+static LogWriter *s_writer = 0;
+
+static void messageHandler(QtMsgType type, const char *message)
+{
+    Logger::Level level;
+    switch (type) {
+    case QtDebugMsg:
+        level = Logger::Debug;
+        break;
+    case QtWarningMsg:
+        level = Logger::Warning;
+        break;
+    default:
+        level = Logger::Error;
+        break;
+    }
+    if (Logger::isEnabled(level))
+        Logger::write(level, QString::fromLocal8Bit(message));
+
+    if (type == QtFatalMsg) {
+        fprintf(stderr, "%s\n", message);
+        Logger::stop();
+        abort();
+    }
+}
+
+void Logger::start(const QString &fileName, Level level)
+{
+    if (s_writer != 0)
+        return;
+
+    ring();
+    setLevel(level);
+    if (level == Off)
+        return;
+
+    s_writer = new LogWriter(fileName);
+    s_writer->start(QThread::LowPriority);
+    qInstallMsgHandler(messageHandler);
+}
+
+void Logger::stop()
+{
+    if (s_writer == 0)
+        return;
+
+    qInstallMsgHandler(0);
+    s_writer->stopWriting();
+    s_writer->wait();
+    delete s_writer;
+    s_writer = 0;
+}
+
+QString Logger::defaultFileName()
+{
+    // next to the settings file, needs the application names to be set
+    QSettings settings;
+    return QFileInfo(settings.fileName()).absolutePath() + "/qtalk.log";
+}
+
+Logger::Level Logger::levelFromString(const QString &name, Level defaultLevel)
+{
+    QString lower = name.toLower();
+    if (lower == "debug")
+        return Debug;
+    if (lower == "info")
+        return Info;
+    if (lower == "warning")
+        return Warning;
+    if (lower == "error")
+        return Error;
+    if (lower == "off" || lower == "none")
+        return Off;
+    return defaultLevel;
+}
+
+void Logger::setLevel(Level level)
+{
+    s_level = level;
+}
+
+Logger::Level Logger::level()
+{
+    return Level(s_level);
+}
+
+void Logger::write(Level level, const QString &message)
+{
+    ring().push(QDateTime::currentMSecsSinceEpoch(), level, message);
+}
+
+int Logger::droppedCount()
+{
+    return ring().dropped();
+}
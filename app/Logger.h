@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QString>
+
+// Statements below this level are compiled out, release builds raise it
+// to Info in app.pro.
+#ifndef QTALK_LOG_LEVEL
+#define QTALK_LOG_LEVEL 0
+#endif
+
+// Process wide log. write() only copies the message into a lock-free ring,
+// a background thread formats the lines and appends them to a rotating
+// file. Qt's qDebug/qWarning output is routed here as well once started.
+class Logger
+{
+public:
+    enum Level { Debug = 0, Info, Warning, Error, Off };
+
+    static void start(const QString &fileName, Level level);
+    static void stop();
+    static QString defaultFileName();
+    static Level levelFromString(const QString &name, Level defaultLevel);
+
+    static void setLevel(Level level);
+    static Level level();
+    static bool isEnabled(Level level) { return level >= s_level; }
+    static void write(Level level, const QString &message);
+    static int droppedCount(); // lost because the ring was full
+
+private:
+    static int s_level;
+};
+
+// the message expression is only evaluated when the level is enabled
+#define QTALK_LOG(level, message) \
+    do { \
+        if ((level) >= QTALK_LOG_LEVEL && Logger::isEnabled(level)) \
+            Logger::write((level), (message)); \
+    } while (0)
+
+#define LOG_DEBUG(message)   QTALK_LOG(Logger::Debug, message)
+#define LOG_INFO(message)    QTALK_LOG(Logger::Info, message)
+#define LOG_WARNING(message) QTALK_LOG(Logger::Warning, message)
+#define LOG_ERROR(message)   QTALK_LOG(Logger::Error, message)
+
+#endif // LOGGER_H
@@ -41,6 +41,9 @@
 #include "RosterModel.h"
 #include <QXmppVCardManager.h>
 #include "TransferManagerWindow.h"
+#include "TransferScheduler.h"
+#include "ProxySelector.h"
+#include "CapsTracker.h"
 #include <QMessageBox>
 #include <QDialog>
 #include <QListWidget>
@@ -53,56 +56,67 @@
 #include <QInputDialog>
 #include <QTranslator>
 #include <QXmppLogger.h>
-
-MainWindow::MainWindow(QWidget *parent) :
+#include "IconCache.h"
+#include "TrayIcon.h"
+#include "Outbox.h"
+#include "ReconnectScheduler.h"
+#include "StartupTrace.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "DiagnosticsWindow.h"
+#include "StallWatchdog.h"
+#include <QShortcut>
+#include <QStatusBar>
+#include <QTimer>
+
+MainWindow::MainWindow(int account, QWidget *parent) :
     QMainWindow(parent),
+    m_preferences(account),
     m_client(new QXmppClient(this)),
+    m_outbox(new Outbox(m_client, 200, this)),
+    m_capsTracker(new CapsTracker(m_client, this)),
+    m_reconnectScheduler(new ReconnectScheduler(this)),
+    m_infoEventStackWidget(0),
     m_rosterModel(new RosterModel(m_client, this)),
     m_rosterTreeView(new QTreeView(this)),
+    m_rosterExpanded(false),
+    m_trayIconMenu(0),
     m_unreadMessageModel(new UnreadMessageModel(this)),
     m_unreadMessageWindow(0),
     m_loginWidget(new LoginWidget(this)),
     m_preferencesDialog(0),
     m_closeToTrayDialog(0),
     m_transferManagerWindow(0),
-    m_addContactDialog(0)
+    m_addContactDialog(0),
+    m_diagnosticsWindow(0),
+    m_proxySelector(0)
 {
     ui.setupUi(this);
+    // every account window, from main() or New Account, is freed on close
+    setAttribute(Qt::WA_DeleteOnClose, true);
+    StartupTrace::mark("main window ui");
     readPreferences();
+    StartupTrace::mark("preferences");
 
     retranslate();
+    StartupTrace::mark("translations");
 
-    QXmppLogger::getLogger()->setLoggingType(QXmppLogger::STDOUT);
+    // the library writes its stanza dump synchronously, only when debugging
+    QXmppLogger::getLogger()->setLoggingType(Logger::isEnabled(Logger::Debug) ? QXmppLogger::FILE
+                                                                               : QXmppLogger::NONE);
 
     m_client->getConfiguration().setAutoAcceptSubscriptions(false);
-    //m_client->getTransferManager().setSupportedMethods(QXmppTransferJob::InBandMethod);
-    m_client->getTransferManager().setProxy("proxy.eu.jabber.org");
-    //m_client->getTransferManager().setProxyOnly(true);
 
-    setupTrayIcon();
     ui.presenceComboBox->setVisible(false);
     ui.showInfoEventButton->setVisible(false);
 
     m_infoEventNone  = new QIcon(":/images/preferences-system-power-management.png");
     m_infoEventExist = new QIcon(":/images/ktip.png");
 
-    m_infoEventStackWidget = new InfoEventStackWidget(m_client, this);
-    QVBoxLayout *bottomLayout = new QVBoxLayout();
-    bottomLayout->addWidget(m_infoEventStackWidget);
-    bottomLayout->setMargin(0);
-    ui.bottomWrap->setLayout(bottomLayout);
-
     connect(ui.showInfoEventButton, SIGNAL(clicked()),
             this, SLOT(showEventStack()) );
-    connect(m_infoEventStackWidget, SIGNAL(countChanged(int)),
-            this, SLOT(infoEventCountChanged(int)) );
     connect(ui.presenceComboBox, SIGNAL(activated(int)),
             this, SLOT(presenceComboxChange(int)) );
-    //m_infoEventStackWidget->addSubscribeRequest("test2");
-
-    m_infoEventStackWidget->setVisible(false);
-    connect(m_infoEventStackWidget, SIGNAL(infoEventCleared()),
-            this, SLOT(updateTrayIcon()) );
 
     m_rosterTreeView->setHeaderHidden(true);
     m_rosterTreeView->setAnimated(true);
@@ -137,6 +151,10 @@ MainWindow::MainWindow(QWidget *parent) :
             this, SLOT(messageReceived(QXmppMessage)) );
     connect(m_client, SIGNAL(presenceReceived(QXmppPresence)),
             this, SLOT(presenceReceived(QXmppPresence)) );
+    connect(m_client, SIGNAL(iqReceived(QXmppIq)),
+            this, SLOT(iqReceived(QXmppIq)) );
+    connect(m_reconnectScheduler, SIGNAL(reconnect()),
+            this, SLOT(autoReconnect()) );
 
     // roster model and view
     connect(m_rosterModel, SIGNAL(parseDone()),
@@ -183,6 +201,17 @@ MainWindow::MainWindow(QWidget *parent) :
             this, SLOT(actionMoveToNewGroup()) );
     connect(ui.actionCopyToNewGroup, SIGNAL(triggered()),
             this, SLOT(actionCopyToNewGroup()) );
+    connect(ui.actionNewAccount, SIGNAL(triggered()),
+            this, SLOT(actionNewAccount()) );
+
+    // not in any menu
+    QShortcut *diagnosticsShortcut = new QShortcut(QKeySequence("Ctrl+Shift+D"), this);
+    connect(diagnosticsShortcut, SIGNAL(activated()),
+            this, SLOT(openDiagnosticsWindow()) );
+
+    // every account window saves its own block when the process quits
+    connect(qApp, SIGNAL(aboutToQuit()),
+            this, SLOT(writePreferences()) );
 
     // VCard
     connect(&m_client->getVCardManager(), SIGNAL(vCardReceived(const QXmppVCard&)),
@@ -193,13 +222,58 @@ MainWindow::MainWindow(QWidget *parent) :
             this, SLOT(receivedTransferJob(QXmppTransferJob*)) );
 
     m_rosterTreeView->setModel(m_rosterModel);
+    StartupTrace::mark("main window constructed");
+
+    // what the first paint does not need waits for the event loop
+    QTimer::singleShot(0, this, SLOT(delayedInit()));
 
     if (m_preferences.autoLogin)
         login();
 }
 
+void MainWindow::delayedInit()
+{
+    setupTrayIcon();
+    StartupTrace::mark("tray icon");
+
+    infoEventStackWidget();
+    StartupTrace::mark("info event stack");
+
+    //m_client->getTransferManager().setSupportedMethods(QXmppTransferJob::InBandMethod);
+    // direct streamhosts are offered before the proxy, keep proxyOnly off so
+    // peers on the same network connect to each other
+    m_proxySelector = new ProxySelector(m_client, this);
+    m_proxySelector->setConfiguredProxies(m_preferences.transferProxies);
+    if (m_outbox->isConnected())
+        m_proxySelector->refresh();
+
+    updateTrayIcon();
+    StartupTrace::mark("delayed init");
+    StartupTrace::dump();
+}
+
+InfoEventStackWidget *MainWindow::infoEventStackWidget()
+{
+    if (m_infoEventStackWidget != 0)
+        return m_infoEventStackWidget;
+
+    m_infoEventStackWidget = new InfoEventStackWidget(m_client, this);
+    QVBoxLayout *bottomLayout = new QVBoxLayout();
+    bottomLayout->addWidget(m_infoEventStackWidget);
+    bottomLayout->setMargin(0);
+    ui.bottomWrap->setLayout(bottomLayout);
+    m_infoEventStackWidget->setVisible(false);
+
+    connect(m_infoEventStackWidget, SIGNAL(countChanged(int)),
+            this, SLOT(infoEventCountChanged(int)) );
+    connect(m_infoEventStackWidget, SIGNAL(infoEventCleared()),
+            this, SLOT(updateTrayIcon()) );
+    return m_infoEventStackWidget;
+}
+
 MainWindow::~MainWindow()
 {
+    TrayIcon::instance()->removeWindow(this);
 }
 
 void MainWindow::readPreferences()
@@ -212,6 +286,9 @@ void MainWindow::readPreferences()
 
     m_loginWidget->readData(&m_preferences);
 
+    if (Preferences::accountCount() > 1 && !m_preferences.jid.isEmpty())
+        setWindowTitle(QString("%1 - %2").arg(m_preferences.jid, windowTitle()));
+
     if (m_preferences.mainWindowGeometry.isEmpty())
         move(QApplication::desktop()->screenGeometry().center() - geometry().center());
     else
@@ -244,17 +321,42 @@ void MainWindow::login()
 
 void MainWindow::clientDisconnected()
 {
+    // dropped by the server, not by the user
+    if (!m_sessionJid.isEmpty())
+        scheduleReconnect();
     updateTrayIcon();
 }
 
 void MainWindow::clientConnected()
 {
+    // the roster of the same account is reconciled when it arrives. after a
+    // short outage also send what was written meanwhile
+    if (!m_sessionJid.isEmpty()) {
+        if (m_sessionJid != m_preferences.jid) {
+            resetSession();
+            m_rosterModel->clear();
+            m_rosterExpanded = false;
+        } else if (m_outbox->canFlush()) {
+            m_outbox->flush();
+        } else {
+            m_outbox->discard();
+        }
+    }
+    m_sessionJid = m_preferences.jid;
+    updateTrayMenuTitle();
+    m_reconnectScheduler->reset();
+    statusBar()->clearMessage();
+
     m_loginWidget->showState(tr("Connect successful"));
     updateTrayIcon();
 }
 
 void MainWindow::messageReceived(const QXmppMessage& message)
 {
+    StallScope stallScope("MainWindow::messageReceived");
+    static qint64 &received = Metrics::counter("stanza.in.message");
+    received++;
+
     QString jid = message.from();
     QString bareJid = jidToBareJid(jid);
     QString resource = jidToResource(jid);
@@ -275,10 +377,14 @@ void MainWindow::messageReceived(const QXmppMessage& message)
 
 void MainWindow::presenceReceived(const QXmppPresence &presence)
 {
+    StallScope stallScope("MainWindow::presenceReceived");
+    static qint64 &received = Metrics::counter("stanza.in.presence");
+    received++;
+
     switch (presence.getType()) {
     case QXmppPresence::Subscribe:
-        m_infoEventStackWidget->addSubscribeRequest(presence.from());
-        m_trayIcon->showMessage(QString(tr("Request")), QString(tr("%1 want to subscribe you")).arg(presence.from()));
+        infoEventStackWidget()->addSubscribeRequest(presence.from());
+        TrayIcon::instance()->showMessage(QString(tr("Request")), QString(tr("%1 want to subscribe you")).arg(presence.from()));
         updateTrayIcon();
         break;
     default:
@@ -318,7 +424,7 @@ void MainWindow::openChatWindow(const QString &jid)
     ChatWindow *chatWindow;
     if (m_chatWindows[jid] == NULL) {
         // new chatWindow
-        chatWindow = new ChatWindow(jid, m_client, this);
+        chatWindow = new ChatWindow(jid, m_client, m_outbox, m_capsTracker, this);
 
         connect(chatWindow, SIGNAL(sendFile(QString,QString)),
                 this, SLOT(createTransferJob(QString,QString)) );
@@ -539,10 +645,8 @@ void MainWindow::actionCopyToGroup()
 
 void MainWindow::showEventStack()
 {
-    if (m_infoEventStackWidget->isVisible())
-        m_infoEventStackWidget->setAnimeVisible(false);
-    else
-        m_infoEventStackWidget->setAnimeVisible(true);
+    InfoEventStackWidget *stackWidget = infoEventStackWidget();
+    stackWidget->setAnimeVisible(!stackWidget->isVisible());
 }
 
 void MainWindow::openContactInfoDialog(QString jid)
@@ -563,29 +667,27 @@ void MainWindow::openContactInfoDialog(QString jid)
     dialog->activateWindow();
 }
 
-void MainWindow::trayIconActivated(QSystemTrayIcon::ActivationReason reason)
+void MainWindow::trayIconActivated()
 {
     if (m_unreadMessageWindow == 0) {
         createUnreadMessageWindow();
     }
 
-    if (reason == QSystemTrayIcon::Trigger) {
-        if (m_unreadMessageModel->hasAnyUnread()
-            && m_unreadMessageWindow->isHidden()) {
-            if (m_unreadMessageModel->rowCount(QModelIndex()) == 1)
-                // single
-                readAllUnreadMessage();
-            else
-                m_unreadMessageWindow->show();
+    if (m_unreadMessageModel->hasAnyUnread()
+        && m_unreadMessageWindow->isHidden()) {
+        if (m_unreadMessageModel->rowCount(QModelIndex()) == 1)
+            // single
+            readAllUnreadMessage();
+        else
+            m_unreadMessageWindow->show();
+    } else {
+        if (isVisible()) {
+            hide();
         } else {
-            if (isVisible()) {
-                hide();
-            } else {
-                //hide();
-                show();
-                raise();
-                activateWindow();
-            }
+            //hide();
+            show();
+            raise();
+            activateWindow();
         }
     }
 }
@@ -628,28 +730,26 @@ void MainWindow::changeEvent(QEvent *event)
 
 void MainWindow::setupTrayIcon()
 {
-    m_trayIcon = new QSystemTrayIcon(this);
-    m_trayIcon->setIcon(QIcon(":/images/im-user-offline.png"));
-
     m_trayIconMenu = new QMenu(this);
+    updateTrayMenuTitle();
 
     // Status change
-    QAction *onlineAction = m_trayIconMenu->addAction(QIcon(":/images/im-user.png"), QString(tr("Online")));
+    QAction *onlineAction = m_trayIconMenu->addAction(IconCache::icon(":/images/im-user.png"), QString(tr("Online")));
     connect(onlineAction, SIGNAL(triggered()),
             this, SLOT(setPresenceOnline()) );
-    QAction *chatAction = m_trayIconMenu->addAction(QIcon(":/images/im-user.png"), QString(tr("Chat")));
+    QAction *chatAction = m_trayIconMenu->addAction(IconCache::icon(":/images/im-user.png"), QString(tr("Chat")));
     connect(chatAction, SIGNAL(triggered()),
             this, SLOT(setPresenceChat()) );
-    QAction *awayAction = m_trayIconMenu->addAction(QIcon(":/images/im-user-away.png"), QString(tr("Away")));
+    QAction *awayAction = m_trayIconMenu->addAction(IconCache::icon(":/images/im-user-away.png"), QString(tr("Away")));
     connect(awayAction, SIGNAL(triggered()),
             this, SLOT(setPresenceAway()) );
-    QAction *xaAction = m_trayIconMenu->addAction(QIcon(":/images/im-user-away.png"), QString(tr("Extened Away")));
+    QAction *xaAction = m_trayIconMenu->addAction(IconCache::icon(":/images/im-user-away.png"), QString(tr("Extened Away")));
     connect(xaAction, SIGNAL(triggered()),
             this, SLOT(setPresenceXa()) );
-    QAction *busyAction = m_trayIconMenu->addAction(QIcon(":/images/im-user-busy.png"), QString(tr("Do Not Disturb")));
+    QAction *busyAction = m_trayIconMenu->addAction(IconCache::icon(":/images/im-user-busy.png"), QString(tr("Do Not Disturb")));
     connect(busyAction, SIGNAL(triggered()),
             this, SLOT(setPresenceDnd()) );
-    QAction *offlineAction = m_trayIconMenu->addAction(QIcon(":/images/im-user-offline.png"), QString(tr("Offline")));
+    QAction *offlineAction = m_trayIconMenu->addAction(IconCache::icon(":/images/im-user-offline.png"), QString(tr("Offline")));
     connect(offlineAction, SIGNAL(triggered()),
             this, SLOT(setPresenceOffline()) );
 
@@ -657,20 +757,26 @@ void MainWindow::setupTrayIcon()
     m_trayIconMenu->addAction(ui.actionTransferManager);
     m_trayIconMenu->addAction(ui.actionPreferences);
 
-    m_trayIconMenu->addSeparator();
-    m_trayIconMenu->addAction(ui.actionQuit);
-    m_trayIcon->setContextMenu(m_trayIconMenu);
-
-    connect(m_trayIcon, SIGNAL(activated(QSystemTrayIcon::ActivationReason)),
-            this, SLOT(trayIconActivated(QSystemTrayIcon::ActivationReason)));
+    // one icon for all accounts, it adds Quit after the account menus
+    TrayIcon::instance()->addWindow(this, m_trayIconMenu);
+}
 
-    m_trayIcon->show();
+void MainWindow::updateTrayMenuTitle()
+{
+    // the submenu name when several accounts share the tray icon
+    if (m_trayIconMenu == 0)
+        return;
+    if (m_preferences.jid.isEmpty())
+        m_trayIconMenu->setTitle(tr("Account %1").arg(m_preferences.account + 1));
+    else
+        m_trayIconMenu->setTitle(m_preferences.jid);
 }
 
 void MainWindow::createUnreadMessageWindow()
 {
     m_unreadMessageWindow = new UnreadMessageWindow(this);
-    m_unreadMessageWindow->move(m_trayIcon->geometry().center() - m_unreadMessageWindow->geometry().center());
+    if (m_trayIconMenu != 0)
+        m_unreadMessageWindow->move(TrayIcon::instance()->geometry().center() - m_unreadMessageWindow->geometry().center());
     m_unreadMessageWindow->setModel(m_unreadMessageModel);
 
     connect(m_unreadMessageWindow, SIGNAL(unreadListClicked(const QModelIndex&)),
@@ -705,21 +811,59 @@ void MainWindow::readAllUnreadMessage()
 
 void MainWindow::clientDisconnect()
 {
-    m_rosterModel->clear();
+    m_reconnectScheduler->cancel();
+    statusBar()->clearMessage();
+    resetSession();
+    m_rosterModel->setAllOffline();
+    m_sessionJid.clear();
+    m_client->disconnect();
+}
+
+void MainWindow::resetSession()
+{
     foreach (ChatWindow *window, m_chatWindows) {
         if (window != NULL)
             window->close();
     }
     m_chatWindows.clear();
-    m_client->disconnect();
+    m_outbox->discard();
 }
 
 void MainWindow::clientError(QXmppClient::Error)
 {
+    // a session was up, keep the roster on screen and retry in background
+    if (!m_sessionJid.isEmpty()) {
+        scheduleReconnect();
+        return;
+    }
+
     m_loginWidget->showState(tr("Connect Error"));
     changeToLogin();
 }
 
+void MainWindow::scheduleReconnect()
+{
+    if (m_reconnectScheduler->isScheduled())
+        return;
+
+    m_reconnectScheduler->schedule();
+    statusBar()->showMessage(QString(tr("Connection lost, reconnect in %1 s"))
+                             .arg((m_reconnectScheduler->nextDelay() + 999) / 1000));
+}
+
+void MainWindow::autoReconnect()
+{
+    if (m_sessionJid.isEmpty())
+        return;
+
+    statusBar()->showMessage(tr("Reconnecting ..."));
+    QXmppPresence presence = m_client->getClientPresence();
+    presence.setType(QXmppPresence::Available);
+    m_client->connectToServer(m_preferences.host, m_preferences.jid,
+                              m_preferences.password, m_preferences.port,
+                              presence);
+}
+
 void MainWindow::openPreferencesDialog()
 {
     if (m_preferencesDialog == 0) {
@@ -782,8 +926,12 @@ void MainWindow::changeToLogin()
 
 void MainWindow::changeToRoster()
 {
+    StallScope stallScope("MainWindow::changeToRoster");
     ui.stackedWidget->setCurrentIndex(1);
-    m_rosterTreeView->expandToDepth(0);
+    if (!m_rosterExpanded) {
+        m_rosterTreeView->expandToDepth(0);
+        m_rosterExpanded = true;
+    }
     ui.presenceComboBox->setVisible(true);
     ui.showInfoEventButton->setVisible(true);
 }
@@ -798,8 +946,27 @@ void MainWindow::rosterIconResize()
     setRosterIconSize(m_preferences.rosterIconSize);
 }
 
+void MainWindow::iqReceived(const QXmppIq &)
+{
+    static qint64 &received = Metrics::counter("stanza.in.iq");
+    received++;
+}
+
+void MainWindow::openDiagnosticsWindow()
+{
+    if (m_diagnosticsWindow == 0)
+        m_diagnosticsWindow = new DiagnosticsWindow(this);
+    m_diagnosticsWindow->show();
+    m_diagnosticsWindow->raise();
+    m_diagnosticsWindow->activateWindow();
+}
+
 void MainWindow::rosterViewHiddenUpdate()
 {
+    StallScope stallScope("MainWindow::rosterViewHiddenUpdate");
+    static Histogram &latency = Metrics::histogram("roster.hiddenUpdate");
+    ScopedLatency scope(latency);
+
     foreach (QModelIndex contactIndex, m_rosterModel->allIndex()) {
         m_rosterTreeView->setRowHidden(contactIndex.row(),
                                        contactIndex.parent(),
@@ -818,6 +985,8 @@ void MainWindow::vCardReveived(const QXmppVCard &vCard)
 void MainWindow::logout()
 {
     clientDisconnect();
+    m_rosterModel->clear();
+    m_rosterExpanded = false;
     changeToLogin();
 }
 
@@ -837,11 +1006,22 @@ void MainWindow::createTransferJob(const QString &jid, const QString &fileName)
 {
     initTransferWindow();
 
+    static const QString fileTransfer = "http://jabber.org/protocol/si/profile/file-transfer";
+
     QString newJid = jid;
     if (jidToResource(jid).isEmpty()) {
         QStringList resources = m_client->getRoster().getAllPresencesForBareJid(jid).keys();
+        // resources whose caps say they can't receive files are not offered
+        bool online = !resources.isEmpty();
+        foreach (const QString &resource, resources) {
+            if (m_capsTracker->supports(jid + "/" + resource, fileTransfer) == CapsTracker::Unsupported)
+                resources.removeOne(resource);
+        }
         if (resources.isEmpty()) {
-            QMessageBox::warning(0, "Contact Offline", "Can not send file to offline contact.");
+            if (online)
+                QMessageBox::warning(0, tr("Not Supported"), tr("The client of this contact can not receive files."));
+            else
+                QMessageBox::warning(0, "Contact Offline", "Can not send file to offline contact.");
             return;
         } else if (resources.count() == 1) {
             // auto select the single resource
@@ -878,6 +1058,9 @@ void MainWindow::createTransferJob(const QString &jid, const QString &fileName)
                 return;
             }
         }
+    } else if (m_capsTracker->supports(jid, fileTransfer) == CapsTracker::Unsupported) {
+        QMessageBox::warning(0, tr("Not Supported"), tr("The client of this contact can not receive files."));
+        return;
     }
 
     m_transferManagerWindow->createTransferJob(newJid, fileName);
@@ -965,6 +1148,11 @@ void MainWindow::initTransferWindow()
         connect(&m_client->getTransferManager(), SIGNAL(finished(QXmppTransferJob*)),
                 m_transferManagerWindow, SLOT(deleteFileHandel(QXmppTransferJob*)) );
 
+        TransferScheduler *scheduler = m_transferManagerWindow->scheduler();
+        scheduler->setMaxActive(m_preferences.transferMaxActive);
+        scheduler->setGlobalAdmissionRate(m_preferences.transferAdmissionRate);
+        scheduler->setPeerAdmissionRate(m_preferences.transferPeerAdmissionRate);
+
     }
 }
 
@@ -1110,38 +1298,37 @@ void MainWindow::setPresenceOffline()
 }
 
 
-void MainWindow::updateTrayIcon()
+void MainWindow::actionNewAccount()
 {
-    if (m_unreadMessageModel->hasAnyUnread()) {
-        m_trayIcon->setIcon(QIcon(":/images/mail-unread-new.png"));
-        return;
-    }
+    // the new account runs in this process, sharing the caches and event loop
+    MainWindow *window = new MainWindow(Preferences::addAccount());
+    window->show();
+}
 
-    if (!m_infoEventStackWidget->isEmpty()) {
-        m_trayIcon->setIcon(QIcon(":/images/ktip.png"));
+void MainWindow::updateTrayIcon()
+{
+    // added to the shared icon after the first paint, synced then
+    if (m_trayIconMenu == 0)
         return;
-    }
 
-    if (m_client->getClientPresence().getType() == QXmppPresence::Available) {
+    TrayIcon::State state = TrayIcon::Offline;
+    if (m_unreadMessageModel->hasAnyUnread()) {
+        state = TrayIcon::Unread;
+    } else if (m_infoEventStackWidget != 0 && !m_infoEventStackWidget->isEmpty()) {
+        state = TrayIcon::InfoEvent;
+    } else if (m_client->getClientPresence().getType() == QXmppPresence::Available) {
         switch (m_client->getClientPresence().getStatus().getType()) {
         case QXmppPresence::Status::Away:
         case QXmppPresence::Status::XA:
-            m_trayIcon->setIcon(QIcon(":/images/im-user-away.png"));
-            return;
+            state = TrayIcon::Away;
+            break;
         case QXmppPresence::Status::DND:
-            m_trayIcon->setIcon(QIcon(":/images/im-user-busy.png"));
-            return;
-            /*
-        case QXmppPresence::Status::Invisible:
-            m_trayIcon->setIcon(QIcon(":/images/im-invisible-user.png"));
-            return;
-            */
+            state = TrayIcon::Busy;
+            break;
         default:
-            m_trayIcon->setIcon(QIcon(":/images/im-user.png"));
-            return;
+            state = TrayIcon::Online;
+            break;
         }
     }
-
-    if (m_client->getClientPresence().getType() == QXmppPresence::Unavailable)
-        m_trayIcon->setIcon(QIcon(":/images/im-user-offline.png"));
+    TrayIcon::instance()->setState(this, state);
 }
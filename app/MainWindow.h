@@ -30,7 +30,6 @@
 #include "ui_MainWindow.h"
 #include <QMap>
 #include <QPointer>
-#include <QSystemTrayIcon>
 #include <QStringListModel>
 #include <QXmppClient.h>
 #include <Preferences.h>
@@ -38,17 +37,23 @@
 #include <QTranslator>
 
 class AddContactDialog;
+class CapsTracker;
 class ChatWindow;
 class CloseNoticeDialog;
 class ContactInfoDialog;
 class InfoEventStackWidget;
+class DiagnosticsWindow;
+class ProxySelector;
+class QXmppIq;
 class LoginWidget;
+class Outbox;
 class PreferencesDialog;
 class QListView;
 class QModelIndex;
 class QTreeView;
 class QXmppMessage;
 class QXmppTransferJob;
+class ReconnectScheduler;
 class RosterModel;
 class RosterTreeView;
 class TransferManagerWindow;
@@ -59,10 +64,14 @@ class MainWindow : public QMainWindow
 {
     Q_OBJECT
 public:
-    MainWindow(QWidget *parent = 0);
+    MainWindow(int account = 0, QWidget *parent = 0);
     ~MainWindow();
+    void trayIconActivated(); // the shared tray icon was clicked for this window
 
 private slots:
+    void delayedInit();
+    void iqReceived(const QXmppIq &);
+    void openDiagnosticsWindow();
     void readPreferences();
     void writePreferences();
     void login();
@@ -88,7 +97,6 @@ private slots:
     void openContactInfoDialog(QString jid);
     void messageReceived(const QXmppMessage&);
     void presenceReceived(const QXmppPresence&);
-    void trayIconActivated(QSystemTrayIcon::ActivationReason reason);
     void unreadMessageCleared();
     void readAllUnreadMessage();
     void clientDisconnect();
@@ -119,6 +127,8 @@ private slots:
     void reConnect();
     void setPresenceOffline();
     void updateTrayIcon();
+    void autoReconnect();
+    void actionNewAccount();
 
 protected:
     void closeEvent(QCloseEvent *event);
@@ -128,15 +138,19 @@ private:
     Ui::MainWindow ui;
     Preferences m_preferences;
     QXmppClient *m_client;
+    Outbox *m_outbox;
+    CapsTracker *m_capsTracker;
+    ReconnectScheduler *m_reconnectScheduler;
+    QString m_sessionJid; // account of the live session, empty after logout
     InfoEventStackWidget *m_infoEventStackWidget;
     QIcon *m_infoEventNone;
     QIcon *m_infoEventExist;
     RosterModel *m_rosterModel;
     QTreeView *m_rosterTreeView;
+    bool m_rosterExpanded; // expand groups once, keep what the user chose after
     QMap<QString, QPointer<ChatWindow> > m_chatWindows;
     QMap<QString, QPointer<ContactInfoDialog> > m_contactInfoDialogs;
-    QSystemTrayIcon *m_trayIcon;
-    QMenu *m_trayIconMenu;
+    QMenu *m_trayIconMenu; // this account's part of the shared tray menu
     QAction *m_quitAction;
     UnreadMessageModel *m_unreadMessageModel;
     UnreadMessageWindow *m_unreadMessageWindow;
@@ -145,10 +159,16 @@ private:
     CloseNoticeDialog *m_closeToTrayDialog;
     TransferManagerWindow *m_transferManagerWindow;
     AddContactDialog *m_addContactDialog;
+    DiagnosticsWindow *m_diagnosticsWindow;
+    ProxySelector *m_proxySelector;
     QTranslator m_translator;
 
     
     void setupTrayIcon();
+    void updateTrayMenuTitle();
+    InfoEventStackWidget *infoEventStackWidget(); // created on first use
+    void resetSession();
+    void scheduleReconnect();
     void createUnreadMessageWindow();
     void retranslate();
 };
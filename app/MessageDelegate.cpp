@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MessageDelegate.h"
+#include "MessageModel.h"
+#include <QAbstractItemView>
+#include <QAbstractTextDocumentLayout>
+#include <QApplication>
+#include <QPainter>
+#include <QTextDocument>
+#include <qmath.h>
+
+static const int MessageMargin = 4;
+static const int MaxCachedLayouts = 200;
+
+MessageDelegate::MessageDelegate(QAbstractItemView *view, QObject *parent) :
+    QStyledItemDelegate(parent),
+    m_view(view),
+    m_layouts(MaxCachedLayouts),
+    m_heightsWidth(-1)
+{
+}
+
+void MessageDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    // background and selection only, the text is drawn from the cached layout
+    QStyleOptionViewItemV4 opt = option;
+    initStyleOption(&opt, index);
+    opt.text = QString();
+    const QWidget *widget = opt.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
+
+    QTextDocument *document = layoutFor(index, option.font, option.rect.width());
+
+    QAbstractTextDocumentLayout::PaintContext context;
+    context.palette = option.palette;
+    if (option.state & QStyle::State_Selected)
+        context.palette.setColor(QPalette::Text, option.palette.color(QPalette::HighlightedText));
+
+    painter->save();
+    painter->translate(option.rect.topLeft() + QPoint(MessageMargin, MessageMargin));
+    context.clip = QRectF(0, 0,
+                          option.rect.width() - 2 * MessageMargin,
+                          option.rect.height() - 2 * MessageMargin);
+    painter->setClipRect(context.clip);
+    document->documentLayout()->draw(painter, context);
+    painter->restore();
+}
+
+QSize MessageDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    int width = m_view->viewport()->width();
+    if (width != m_heightsWidth) {
+        m_heights.clear();
+        m_heightsWidth = width;
+    }
+
+    quint64 serial = index.data(MessageModel::SerialRole).toULongLong();
+    QHash<quint64, int>::const_iterator it = m_heights.constFind(serial);
+    if (it != m_heights.constEnd())
+        return QSize(width, it.value());
+
+    // serials only grow, so stale entries of trimmed messages are simply dropped
+    if (m_heights.count() > 4 * MaxCachedLayouts)
+        m_heights.clear();
+
+    QTextDocument *document = layoutFor(index, option.font, width);
+    int height = qCeil(document->size().height()) + 2 * MessageMargin;
+    m_heights.insert(serial, height);
+    return QSize(width, height);
+}
+
+QTextDocument *MessageDelegate::layoutFor(const QModelIndex &index, const QFont &font, int width) const
+{
+    quint64 serial = index.data(MessageModel::SerialRole).toULongLong();
+    qreal textWidth = qMax(1, width - 2 * MessageMargin);
+
+    QTextDocument *document = m_layouts.object(serial);
+    if (document == 0) {
+        document = new QTextDocument;
+        document->setDocumentMargin(0);
+        document->setDefaultFont(font);
+        document->setHtml(QString("<div style=\"color:gray;\">%1</div>%2")
+                          .arg(Qt::escape(index.data(Qt::DisplayRole).toString()),
+                               index.data(MessageModel::HtmlRole).toString()));
+        m_layouts.insert(serial, document);
+    }
+
+    if (document->textWidth() != textWidth)
+        document->setTextWidth(textWidth);
+    return document;
+}
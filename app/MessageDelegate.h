@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MESSAGEDELEGATE_H
+#define MESSAGEDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QCache>
+#include <QHash>
+
+class QAbstractItemView;
+class QTextDocument;
+
+// Lay out a message only when the view asks for it, and keep the layouts of
+// recently shown messages so scrolling does not relayout the same text.
+class MessageDelegate : public QStyledItemDelegate
+{
+Q_OBJECT
+public:
+    explicit MessageDelegate(QAbstractItemView *view, QObject *parent = 0);
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
+private:
+    QAbstractItemView *m_view;
+    mutable QCache<quint64, QTextDocument> m_layouts; // <serial, layout>
+    mutable QHash<quint64, int> m_heights;             // <serial, height>
+    mutable int m_heightsWidth;
+
+    QTextDocument *layoutFor(const QModelIndex &index, const QFont &font, int width) const;
+};
+
+#endif // MESSAGEDELEGATE_H
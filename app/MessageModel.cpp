@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MessageModel.h"
+#include <QTextDocumentFragment>
+
+MessageModel::MessageModel(int maxMessages, QObject *parent) :
+    QAbstractListModel(parent),
+    m_maxMessages(qMax(1, maxMessages)),
+    m_dropped(0),
+    m_nextSerial(0)
+{
+}
+
+int MessageModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_messages.count();
+}
+
+QVariant MessageModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_messages.count())
+        return QVariant();
+
+    const Message &message = m_messages.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1 %2").arg(message.from, message.time.toString());
+    case FromRole:
+        return message.from;
+    case TimeRole:
+        return message.time;
+    case HtmlRole:
+        return message.html;
+    case SerialRole:
+        return message.serial;
+    default:
+        break;
+    }
+    return QVariant();
+}
+
+void MessageModel::appendMessage(const QString &from, const QTime &time, const QString &html)
+{
+    // drop the oldest message first, the list never grows past the window
+    if (m_messages.count() >= m_maxMessages)
+        trim(m_messages.count() - m_maxMessages + 1);
+
+    Message message;
+    message.serial = m_nextSerial++;
+    message.from = from;
+    message.time = time;
+    message.html = html;
+
+    int row = m_messages.count();
+    beginInsertRows(QModelIndex(), row, row);
+    m_messages.append(message);
+    endInsertRows();
+}
+
+void MessageModel::setMaxMessages(int maxMessages)
+{
+    m_maxMessages = qMax(1, maxMessages);
+    if (m_messages.count() > m_maxMessages)
+        trim(m_messages.count() - m_maxMessages);
+}
+
+int MessageModel::maxMessages() const
+{
+    return m_maxMessages;
+}
+
+int MessageModel::droppedCount() const
+{
+    return m_dropped;
+}
+
+QString MessageModel::plainTextAt(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= m_messages.count())
+        return QString();
+
+    const Message &message = m_messages.at(index.row());
+    return QString("%1 %2\n%3").arg(message.from, message.time.toString(),
+            QTextDocumentFragment::fromHtml(message.html).toPlainText());
+}
+
+void MessageModel::trim(int count)
+{
+    if (count <= 0)
+        return;
+
+    beginRemoveRows(QModelIndex(), 0, count - 1);
+    for (int i = 0; i < count; i++)
+        m_messages.removeFirst();
+    endRemoveRows();
+
+    m_dropped += count;
+    emit droppedCountChanged(m_dropped);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MESSAGEMODEL_H
+#define MESSAGEMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QTime>
+
+// Keep only the last messages of a conversation in memory, so appending stays
+// cheap however long the chat window is kept open. How many were let go is
+// counted, so the window can tell the user its scrollback is cut.
+class MessageModel : public QAbstractListModel
+{
+Q_OBJECT
+public:
+    enum MessageRole
+    {
+        FromRole = Qt::UserRole + 1,
+        TimeRole,
+        HtmlRole,
+        SerialRole
+    };
+
+    explicit MessageModel(int maxMessages = 500, QObject *parent = 0);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    void appendMessage(const QString &from, const QTime &time, const QString &html);
+    void setMaxMessages(int maxMessages);
+    int maxMessages() const;
+    int droppedCount() const; // older messages no longer in the model
+    QString plainTextAt(const QModelIndex &index) const;
+
+signals:
+    void droppedCountChanged(int count);
+
+private:
+    struct Message
+    {
+        quint64 serial;
+        QString from;
+        QTime time;
+        QString html;
+    };
+
+    QList<Message> m_messages;
+    int m_maxMessages;
+    int m_dropped;
+    quint64 m_nextSerial;
+
+    void trim(int count);
+};
+
+#endif // MESSAGEMODEL_H
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "Metrics.h"
+#include <QMap>
+
+Histogram::Histogram() :
+    m_count(0),
+    m_sum(0),
+    m_max(0)
+{
+    for (int i = 0; i < Buckets; i++) {
+        m_buckets[i] = 0;
+    }
+}
+
+void Histogram::record(qint64 micros)
+{
+    // bucket i holds values below 2^i
+    int bucket = 0;
+    while (bucket < Buckets - 1 && (Q_INT64_C(1) << bucket) <= micros)
+        bucket++;
+    m_buckets[bucket]++;
+    m_count++;
+    m_sum += micros;
+    m_max = qMax(m_max, micros);
+}
+
+qint64 Histogram::count() const
+{
+    return m_count;
+}
+
+qint64 Histogram::sum() const
+{
+    return m_sum;
+}
+
+qint64 Histogram::max() const
+{
+    return m_max;
+}
+
+qint64 Histogram::percentile(int percent) const
+{
+    if (m_count == 0)
+        return 0;
+
+    qint64 wanted = (m_count * percent + 99) / 100;
+    qint64 seen = 0;
+    for (int i = 0; i < Buckets; i++) {
+        seen += m_buckets[i];
+        if (seen >= wanted)
+            return qMin(Q_INT64_C(1) << i, m_max);
+    }
+    return m_max;
+}
+
+// QMap nodes do not move, so references handed out stay valid
+static QMap<QString, qint64> &counters()
+{
+    static QMap<QString, qint64> map;
+    return map;
+}
+
+static QMap<QString, qint64> &gauges()
+{
+    static QMap<QString, qint64> map;
+    return map;
+}
+
+static QMap<QString, Histogram> &histograms()
+{
+    static QMap<QString, Histogram> map;
+    return map;
+}
+
+qint64 &Metrics::counter(const QString &name)
+{
+    return counters()[name];
+}
+
+qint64 &Metrics::gauge(const QString &name)
+{
+    return gauges()[name];
+}
+
+Histogram &Metrics::histogram(const QString &name)
+{
+    return histograms()[name];
+}
+
+QStringList Metrics::report()
+{
+    QStringList lines;
+    QMap<QString, qint64>::const_iterator it;
+    for (it = counters().constBegin(); it != counters().constEnd(); ++it) {
+        lines << QString("%1 = %2").arg(it.key()).arg(it.value());
+    }
+    for (it = gauges().constBegin(); it != gauges().constEnd(); ++it) {
+        lines << QString("%1 = %2").arg(it.key()).arg(it.value());
+    }
+    QMap<QString, Histogram>::const_iterator hit;
+    for (hit = histograms().constBegin(); hit != histograms().constEnd(); ++hit) {
+        const Histogram &h = hit.value();
+        lines << QString("%1: n=%2 p50<%3us p95<%4us p99<%5us max=%6us")
+                 .arg(hit.key()).arg(h.count())
+                 .arg(h.percentile(50)).arg(h.percentile(95)).arg(h.percentile(99))
+                 .arg(h.max());
+    }
+    lines.sort();
+    return lines;
+}
+
+static QString jsonString(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+static QString jsonValues(const QMap<QString, qint64> &map)
+{
+    QStringList members;
+    QMap<QString, qint64>::const_iterator it;
+    for (it = map.constBegin(); it != map.constEnd(); ++it) {
+        members << QString("%1: %2").arg(jsonString(it.key())).arg(it.value());
+    }
+    return '{' + members.join(", ") + '}';
+}
+
+QString Metrics::toJson()
+{
+    QStringList members;
+    QMap<QString, Histogram>::const_iterator it;
+    for (it = histograms().constBegin(); it != histograms().constEnd(); ++it) {
+        const Histogram &h = it.value();
+        members << QString("%1: {\"count\": %2, \"sum\": %3, \"max\": %4, "
+                           "\"p50\": %5, \"p95\": %6, \"p99\": %7}")
+                   .arg(jsonString(it.key())).arg(h.count()).arg(h.sum()).arg(h.max())
+                   .arg(h.percentile(50)).arg(h.percentile(95)).arg(h.percentile(99));
+    }
+
+    return QString("{\"counters\": %1, \"gauges\": %2, \"histograms\": {%3}}")
+            .arg(jsonValues(counters()))
+            .arg(jsonValues(gauges()))
+            .arg(members.join(", "));
+}
+
+GaugeShare::GaugeShare(const QString &name) :
+    m_gauge(Metrics::gauge(name)),
+    m_value(0)
+{
+}
+
+GaugeShare::~GaugeShare()
+{
+    m_gauge -= m_value;
+}
+
+void GaugeShare::set(qint64 value)
+{
+    m_gauge += value - m_value;
+    m_value = value;
+}
+
+ScopedLatency::ScopedLatency(Histogram &histogram) :
+    m_histogram(histogram)
+{
+    m_timer.start();
+}
+
+ScopedLatency::~ScopedLatency()
+{
+#if QT_VERSION >= 0x040800
+    m_histogram.record(m_timer.nsecsElapsed() / 1000);
+#else
+    m_histogram.record(m_timer.elapsed() * 1000);
+#endif
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+// Latencies in microseconds, bucketed by powers of two.
+class Histogram
+{
+public:
+    enum { Buckets = 24 };
+
+    Histogram();
+    void record(qint64 micros);
+    qint64 count() const;
+    qint64 sum() const;
+    qint64 max() const;
+    qint64 percentile(int percent) const; // upper bound of the bucket
+
+private:
+    qint64 m_buckets[Buckets];
+    qint64 m_count;
+    qint64 m_sum;
+    qint64 m_max;
+};
+
+// Process wide counters, gauges and histograms, GUI thread only like the
+// code they measure. The returned references stay valid for the life of
+// the process, hot paths keep them in a function static:
+//
+//     static qint64 &inserted = Metrics::counter("roster.rows.inserted");
+//     inserted += count;
+class Metrics
+{
+public:
+    static qint64 &counter(const QString &name);
+    static qint64 &gauge(const QString &name);
+    static Histogram &histogram(const QString &name);
+
+    static QStringList report(); // one line per metric, sorted by name
+    static QString toJson();
+};
+
+// One object's part of a gauge that several objects feed, one per account
+// for example. The gauge holds the sum of the parts; a part is taken back
+// out when its object goes away.
+class GaugeShare
+{
+public:
+    explicit GaugeShare(const QString &name);
+    ~GaugeShare();
+    void set(qint64 value);
+
+private:
+    qint64 &m_gauge;
+    qint64 m_value;
+
+    Q_DISABLE_COPY(GaugeShare)
+};
+
+// Records the time until the end of the scope into a histogram.
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(Histogram &histogram);
+    ~ScopedLatency();
+
+private:
+    Histogram &m_histogram;
+    QElapsedTimer m_timer;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+
+MetricsServer::MetricsServer(QObject *parent) :
+    QObject(parent),
+    m_server(new QLocalServer(this))
+{
+    connect(m_server, SIGNAL(newConnection()),
+            this, SLOT(newConnection()) );
+}
+
+bool MetricsServer::listen(const QString &name)
+{
+    // a previous crash may have left the socket file behind
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name)) {
+        LOG_WARNING(QString("[MetricsServer] cannot listen on %1: %2")
+                    .arg(name).arg(m_server->errorString()));
+        return false;
+    }
+    return true;
+}
+
+void MetricsServer::newConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        connect(socket, SIGNAL(disconnected()),
+                socket, SLOT(deleteLater()) );
+        socket->write(Metrics::toJson().toUtf8());
+        socket->write("\n");
+        socket->disconnectFromServer();
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+
+class QLocalServer;
+
+// Answers every connection on a local socket with Metrics::toJson() and
+// closes it, e.g. "socat - UNIX-CONNECT:/tmp/NAME".
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject *parent = 0);
+    bool listen(const QString &name);
+
+private slots:
+    void newConnection();
+
+private:
+    QLocalServer *m_server;
+};
+
+#endif // METRICSSERVER_H
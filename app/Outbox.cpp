@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "Outbox.h"
+
+// after longer outages the queued messages are dropped with the session
+static const int FlushTimeout = 300;
+
+static qint64 &sentCounter()
+{
+    static qint64 &sent = Metrics::counter("stanza.out.message");
+    return sent;
+}
+
+Outbox::Outbox(QXmppClient *client, int maxQueued, QObject *parent) :
+    QObject(parent),
+    m_client(client),
+    m_maxQueued(qMax(1, maxQueued)),
+    m_connected(false),
+    m_sentCount(0),
+    m_flushedCount(0),
+    m_droppedCount(0),
+    m_queuedGauge("outbox.queued")
+{
+    connect(m_client, SIGNAL(connected()),
+            this, SLOT(clientConnected()) );
+    connect(m_client, SIGNAL(disconnected()),
+            this, SLOT(clientDisconnected()) );
+    connect(m_client, SIGNAL(error(QXmppClient::Error)),
+            this, SLOT(clientDisconnected()) );
+}
+
+void Outbox::sendMessage(const QXmppMessage &message)
+{
+    m_sentCount++;
+    if (m_connected) {
+        m_client->sendPacket(message);
+        sentCounter()++;
+        return;
+    }
+
+    if (m_queue.count() >= m_maxQueued) {
+        m_queue.removeFirst();
+        m_droppedCount++;
+    }
+    m_queue.append(message);
+    m_queuedGauge.set(m_queue.count());
+}
+
+bool Outbox::canFlush() const
+{
+    return m_disconnectedAt.isValid()
+            && m_disconnectedAt.secsTo(QDateTime::currentDateTime()) < FlushTimeout;
+}
+
+void Outbox::flush()
+{
+    foreach (QXmppMessage message, m_queue) {
+        m_client->sendPacket(message);
+    }
+    m_flushedCount += m_queue.count();
+    sentCounter() += m_queue.count();
+    m_queue.clear();
+    m_queuedGauge.set(0);
+    m_disconnectedAt = QDateTime();
+}
+
+void Outbox::discard()
+{
+    m_droppedCount += m_queue.count();
+    m_queue.clear();
+    m_queuedGauge.set(0);
+    m_disconnectedAt = QDateTime();
+}
+
+bool Outbox::isConnected() const
+{
+    return m_connected;
+}
+
+int Outbox::queuedCount() const
+{
+    return m_queue.count();
+}
+
+quint64 Outbox::sentCount() const
+{
+    return m_sentCount;
+}
+
+quint64 Outbox::flushedCount() const
+{
+    return m_flushedCount;
+}
+
+quint64 Outbox::droppedCount() const
+{
+    return m_droppedCount;
+}
+
+void Outbox::clientConnected()
+{
+    m_connected = true;
+}
+
+void Outbox::clientDisconnected()
+{
+    if (m_connected)
+        m_disconnectedAt = QDateTime::currentDateTime();
+    m_connected = false;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QList>
+#include <QXmppClient.h>
+#include <QXmppMessage.h>
+#include "Metrics.h"
+
+// Outgoing chat messages go through this outbox. While the stream is down
+// they are kept, up to a bound, and flushed after the next login if the
+// outage was short. This is not stream resumption: the server sees a fresh
+// session, and what it had not delivered before the outage is not known.
+class Outbox : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Outbox(QXmppClient *client, int maxQueued = 200, QObject *parent = 0);
+    void sendMessage(const QXmppMessage &message);
+
+    // true if the last outage is short enough to keep the queued messages
+    bool canFlush() const;
+    void flush();   // send the queued messages on the fresh login
+    void discard(); // forget them, the session is rebuilt from scratch
+
+    bool isConnected() const;
+    int queuedCount() const;
+    quint64 sentCount() const;
+    quint64 flushedCount() const;
+    quint64 droppedCount() const;
+
+private slots:
+    void clientConnected();
+    void clientDisconnected();
+
+private:
+    QXmppClient *m_client;
+    QList<QXmppMessage> m_queue;
+    int m_maxQueued;
+    bool m_connected;
+    QDateTime m_disconnectedAt;
+    quint64 m_sentCount;
+    quint64 m_flushedCount;
+    quint64 m_droppedCount;
+    GaugeShare m_queuedGauge;
+};
+
+#endif // OUTBOX_H
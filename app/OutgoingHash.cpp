@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "OutgoingHash.h"
+#include <QThread>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#endif
+
+static const qint64 ChunkSize = 256 * 1024;
+
+class OutgoingHashReader : public QThread
+{
+public:
+    OutgoingHashReader(OutgoingHash *hash) : m_hash(hash) {}
+
+protected:
+    void run()
+    {
+        OutgoingHash *hash = m_hash;
+        QByteArray chunk;
+        for (;;) {
+            hash->m_mutex.lock();
+            while (hash->m_hashed >= hash->m_target && !hash->m_closing) {
+                hash->m_moved.wait(&hash->m_mutex);
+            }
+            qint64 from = hash->m_hashed;
+            qint64 to = hash->m_target;
+            hash->m_mutex.unlock();
+            if (from >= to)
+                return;
+
+            chunk = hash->m_file.read(qMin(ChunkSize, to - from));
+
+            hash->m_mutex.lock();
+            if (chunk.isEmpty()) {
+                // the file is shorter than promised, nothing more will come
+                hash->m_target = hash->m_hashed;
+            } else {
+                hash->m_hash.addData(chunk);
+                hash->m_hashed += chunk.size();
+            }
+            hash->m_mutex.unlock();
+        }
+    }
+
+private:
+    OutgoingHash *m_hash;
+};
+
+OutgoingHash::OutgoingHash(const QString &fileName) :
+    m_file(fileName),
+    m_hash(QCryptographicHash::Md5),
+    m_reader(0),
+    m_target(0),
+    m_hashed(0),
+    m_closing(false)
+{
+    if (!m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return;
+#if defined(Q_OS_UNIX) && defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(m_file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    m_reader = new OutgoingHashReader(this);
+    m_reader->start();
+}
+
+OutgoingHash::~OutgoingHash()
+{
+    // a job that goes away early needs no digest, stop where the reader is
+    m_mutex.lock();
+    m_target = m_hashed;
+    m_mutex.unlock();
+    stopReader();
+}
+
+bool OutgoingHash::isValid() const
+{
+    return m_file.isOpen();
+}
+
+void OutgoingHash::advance(qint64 done)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_reader == 0 || done <= m_target)
+        return;
+    m_target = done;
+    m_moved.wakeOne();
+}
+
+void OutgoingHash::stopReader()
+{
+    if (m_reader == 0)
+        return;
+
+    m_mutex.lock();
+    m_closing = true;
+    m_moved.wakeOne();
+    m_mutex.unlock();
+    m_reader->wait();
+    delete m_reader;
+    m_reader = 0;
+}
+
+qint64 OutgoingHash::hashedSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hashed;
+}
+
+QByteArray OutgoingHash::result()
+{
+    if (m_reader == 0)
+        return m_hash.result();
+
+    // whatever progress signal was missed at the end, the reader has kept
+    // pace with the transfer so only the tail is left to wait for
+    advance(m_file.size());
+    stopReader();
+    return m_hash.result();
+}
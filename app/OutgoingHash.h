@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef OUTGOINGHASH_H
+#define OUTGOINGHASH_H
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+
+class OutgoingHashReader;
+
+// Digest of a file being sent, advanced with the transfer progress so it is
+// ready when the last byte goes out. This is a second read of the file,
+// next to the one the transfer makes; it trails the transfer so it is
+// usually served from the page cache rather than the disk.
+//
+// The file is only read from a reader thread: advance() moves the target
+// and returns, result() waits for the reader to reach the end.
+class OutgoingHash
+{
+public:
+    explicit OutgoingHash(const QString &fileName);
+    ~OutgoingHash();
+    bool isValid() const;
+    void advance(qint64 done);
+    qint64 hashedSize() const;
+    QByteArray result();
+
+private:
+    friend class OutgoingHashReader;
+
+    // owned by the reader thread while it runs
+    QFile m_file;
+    QCryptographicHash m_hash;
+
+    // shared with the reader thread
+    OutgoingHashReader *m_reader;
+    mutable QMutex m_mutex;
+    QWaitCondition m_moved;
+    qint64 m_target;
+    qint64 m_hashed;
+    bool m_closing;
+
+    void stopReader();
+};
+
+#endif // OUTGOINGHASH_H
@@ -67,6 +67,7 @@ void PrefChatWindow::readData(Preferences *pref)
         ui->enterRadioButton->setChecked(true);
     else
         ui->ctrlEnterRadioButton->setChecked(true);
+    ui->scrollbackSpinBox->setValue(pref->chatScrollback);
 }
 
 void PrefChatWindow::writeData(Preferences *pref)
@@ -75,4 +76,5 @@ void PrefChatWindow::writeData(Preferences *pref)
         pref->enterToSendMessage = true;
     else
         pref->enterToSendMessage = false;
+    pref->chatScrollback = ui->scrollbackSpinBox->value();
 }
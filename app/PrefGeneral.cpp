@@ -39,16 +39,29 @@ PrefGeneral::PrefGeneral(QWidget *parent) :
     connect(ui->iconSizeSpinBox, SIGNAL(valueChanged(int)),
             this, SLOT(iconSizeChanged()) );
 
+    ui->languageComboBox->addItem(QString("en"), QString("en"));
+    foreach (const QString language, availableLanguages()) {
+        ui->languageComboBox->addItem(language, language);
+    }
+}
+
+// the translations directory does not change while running, scan it once
+QStringList PrefGeneral::availableLanguages()
+{
+    static QStringList languages;
+    static bool scanned = false;
+    if (scanned)
+        return languages;
+
     const QString trPath = QCoreApplication::applicationDirPath() + "/translations";
     const QStringList languageFiles = QDir(trPath).entryList(QStringList("qtalk*.qm"));
-
-    ui->languageComboBox->addItem(QString("en"), QString("en"));
     foreach (const QString languageFile, languageFiles) {
         int start = languageFile.indexOf("_") + 1;
         int end = languageFile.lastIndexOf('.');
-        const QString language = languageFile.mid(start, end - start);
-        ui->languageComboBox->addItem(language, language);
+        languages << languageFile.mid(start, end - start);
     }
+    scanned = true;
+    return languages;
 }
 
 PrefGeneral::~PrefGeneral()
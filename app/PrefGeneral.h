@@ -59,6 +59,7 @@ protected:
 
 private:
     Ui::PrefGeneral *ui;
+    static QStringList availableLanguages();
     bool m_languageChange;
     bool m_hideOfflineChange;
     bool m_showResourcesChange;
@@ -27,27 +27,48 @@
 #include "Preferences.h"
 #include <QSettings>
 
-Preferences::Preferences()
+Preferences::Preferences(int index) :
+    account(index)
 {
 }
 
+// the first account keeps the group names used before multi account support
+static QString accountGroup(const QString &group, int account)
+{
+    if (account == 0)
+        return group;
+    return QString("%1%2").arg(group).arg(account);
+}
+
+int Preferences::accountCount()
+{
+    QSettings settings;
+    return qMax(1, settings.value("general/accountCount", 1).toInt());
+}
+
+int Preferences::addAccount()
+{
+    QSettings settings;
+    int count = accountCount();
+    settings.setValue("general/accountCount", count + 1);
+    return count;
+}
+
 void Preferences::load()
 {
     QSettings settings;
 
     // General
-    settings.beginGroup("general");
-    language = settings.value("language").toString();
-    hideOffline = settings.value("hideOffline", false).toBool();
-    showResources = settings.value("showResources", true).toBool();
-    showSingleResource = settings.value("showSingleResource", false).toBool();
-    rosterIconSize = settings.value("rosterIconSize", 32).toInt();
-    closeToTray = settings.value("closeToTray", true).toBool();
-    closeToTrayNotice = settings.value("closeToTrayNotice", true).toBool();
-    settings.endGroup();
+    language = loadShared(settings, "general/language", QString()).toString();
+    hideOffline = loadShared(settings, "general/hideOffline", false).toBool();
+    showResources = loadShared(settings, "general/showResources", true).toBool();
+    showSingleResource = loadShared(settings, "general/showSingleResource", false).toBool();
+    rosterIconSize = loadShared(settings, "general/rosterIconSize", 32).toInt();
+    closeToTray = loadShared(settings, "general/closeToTray", true).toBool();
+    closeToTrayNotice = loadShared(settings, "general/closeToTrayNotice", true).toBool();
 
     // Account
-    settings.beginGroup("account");
+    settings.beginGroup(accountGroup("account", account));
     jid = settings.value("jid").toString();
     storePassword = settings.value("storePassword", false).toBool();
     if (storePassword)
@@ -60,12 +81,17 @@ void Preferences::load()
     settings.endGroup();
 
     // ChatWindow
-    settings.beginGroup("chatwindow");
-    enterToSendMessage = settings.value("enterToSendMessage", false).toBool();
-    settings.endGroup();
+    enterToSendMessage = loadShared(settings, "chatwindow/enterToSendMessage", false).toBool();
+    chatScrollback = loadShared(settings, "chatwindow/scrollback", 500).toInt();
+
+    // Transfer
+    transferMaxActive = loadShared(settings, "transfer/maxActive", 2).toInt();
+    transferAdmissionRate = loadShared(settings, "transfer/admissionRate", 0).toInt();
+    transferPeerAdmissionRate = loadShared(settings, "transfer/peerAdmissionRate", 0).toInt();
+    transferProxies = loadShared(settings, "transfer/proxies", QStringList()).toStringList();
 
     // mainWindow
-    settings.beginGroup("mainWindow");
+    settings.beginGroup(accountGroup("mainWindow", account));
     mainWindowGeometry = settings.value("geometry").toByteArray();
     mainWindowState = settings.value("state").toByteArray();
     settings.endGroup();
@@ -76,18 +102,16 @@ void Preferences::save()
     QSettings settings;
 
     // General
-    settings.beginGroup("general");
-    settings.setValue("language", language);
-    settings.setValue("hideOffline", hideOffline);
-    settings.setValue("showResources", showResources);
-    settings.setValue("showSingleResource", showSingleResource);
-    settings.setValue("rosterIconSize", rosterIconSize);
-    settings.setValue("closeToTray", closeToTray);
-    settings.setValue("closeToTrayNotice", closeToTrayNotice);
-    settings.endGroup();
+    saveShared(settings, "general/language", language);
+    saveShared(settings, "general/hideOffline", hideOffline);
+    saveShared(settings, "general/showResources", showResources);
+    saveShared(settings, "general/showSingleResource", showSingleResource);
+    saveShared(settings, "general/rosterIconSize", rosterIconSize);
+    saveShared(settings, "general/closeToTray", closeToTray);
+    saveShared(settings, "general/closeToTrayNotice", closeToTrayNotice);
 
     // Account
-    settings.beginGroup("account");
+    settings.beginGroup(accountGroup("account", account));
     settings.setValue("jid", jid);
     if (storePassword)
         settings.setValue("password", password);
@@ -100,13 +124,35 @@ void Preferences::save()
     settings.endGroup();
 
     // ChatWindow
-    settings.beginGroup("chatwindow");
-    settings.setValue("enterToSendMessage", enterToSendMessage);
-    settings.endGroup();
+    saveShared(settings, "chatwindow/enterToSendMessage", enterToSendMessage);
+    saveShared(settings, "chatwindow/scrollback", chatScrollback);
+
+    // Transfer
+    saveShared(settings, "transfer/maxActive", transferMaxActive);
+    saveShared(settings, "transfer/admissionRate", transferAdmissionRate);
+    saveShared(settings, "transfer/peerAdmissionRate", transferPeerAdmissionRate);
+    saveShared(settings, "transfer/proxies", transferProxies);
 
     // mainWindow
-    settings.beginGroup("mainWindow");
+    settings.beginGroup(accountGroup("mainWindow", account));
     settings.setValue("geometry", mainWindowGeometry);
     settings.setValue("state", mainWindowState);
     settings.endGroup();
 }
+
+QVariant Preferences::loadShared(QSettings &settings, const QString &key, const QVariant &defaultValue)
+{
+    // typed like the member so save() compares like with like
+    QVariant value = settings.value(key, defaultValue);
+    value.convert(defaultValue.type());
+    m_shared.insert(key, value);
+    return value;
+}
+
+void Preferences::saveShared(QSettings &settings, const QString &key, const QVariant &value)
+{
+    if (m_shared.contains(key) && m_shared.value(key) == value)
+        return;
+    settings.setValue(key, value);
+    m_shared.insert(key, value);
+}
@@ -27,15 +27,26 @@
 #ifndef PREFERENCES_H
 #define PREFERENCES_H
 
+#include <QMap>
 #include <QString>
+#include <QStringList>
+#include <QVariant>
+
+class QSettings;
 
 class Preferences
 {
 public:
-    Preferences();
+    Preferences(int index = 0);
     void load();
     void save();
 
+    // accounts are numbered from 0, each has its own account and window block
+    static int accountCount();
+    static int addAccount(); // return the index of the new account
+
+    int account;
+
     // General
     QString language;
     bool hideOffline;
@@ -55,10 +66,27 @@ public:
 
     // ChatWindow
     bool enterToSendMessage;
+    int chatScrollback; // messages kept in a chat window
+
+    // Transfer, rates in bytes per second, 0 is unlimited. The rates only
+    // hold back the start of queued jobs, see TransferScheduler
+    int transferMaxActive;
+    int transferAdmissionRate;
+    int transferPeerAdmissionRate;
+    QStringList transferProxies; // tried besides those found on the server
 
     // Mainwindow
     QByteArray mainWindowGeometry;
     QByteArray mainWindowState;
+
+private:
+    // the general, chatwindow and transfer groups are shared by every
+    // account's window, save() only writes the keys this copy changed so a
+    // stale copy can't undo another window's change
+    QMap<QString, QVariant> m_shared; // as last read or written
+
+    QVariant loadShared(QSettings &settings, const QString &key, const QVariant &defaultValue);
+    void saveShared(QSettings &settings, const QString &key, const QVariant &value);
 };
 
 #endif // PREFERENCES_H
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ProxySelector.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <QXmppClient.h>
+#include <QXmppDiscoveryIq.h>
+#include <QTimer>
+
+static const int RefreshInterval = 10 * 60 * 1000;
+static const int ProbeTimeout = 5000;
+
+ProxySelector::ProxySelector(QXmppClient *client, QObject *parent) :
+    QObject(parent),
+    m_client(client),
+    m_refreshTimer(new QTimer(this)),
+    m_expireTimer(new QTimer(this))
+{
+    m_clock.start();
+    m_refreshTimer->setInterval(RefreshInterval);
+    m_expireTimer->setSingleShot(true);
+    m_expireTimer->setInterval(ProbeTimeout);
+
+    connect(m_client, SIGNAL(connected()),
+            this, SLOT(refresh()) );
+    connect(m_client, SIGNAL(disconnected()),
+            m_refreshTimer, SLOT(stop()) );
+    connect(m_client, SIGNAL(discoveryIqReceived(QXmppDiscoveryIq)),
+            this, SLOT(discoveryIqReceived(QXmppDiscoveryIq)) );
+    connect(m_refreshTimer, SIGNAL(timeout()),
+            this, SLOT(refresh()) );
+    connect(m_expireTimer, SIGNAL(timeout()),
+            this, SLOT(expireProbes()) );
+}
+
+void ProxySelector::setConfiguredProxies(const QStringList &jids)
+{
+    m_configured = jids;
+}
+
+QString ProxySelector::currentProxy() const
+{
+    return m_current;
+}
+
+void ProxySelector::refresh()
+{
+    m_refreshTimer->start();
+    m_latencies.clear();
+
+    QXmppDiscoveryIq items;
+    items.setType(QXmppIq::Get);
+    items.setQueryType(QXmppDiscoveryIq::ItemsQuery);
+    items.setTo(m_client->getConfiguration().domain());
+    m_itemsRequest = items.id();
+    m_client->sendPacket(items);
+
+    foreach (QString jid, m_configured) {
+        probe(jid);
+    }
+}
+
+void ProxySelector::probe(const QString &jid)
+{
+    if (m_probes.values().contains(jid))
+        return;
+
+    QXmppDiscoveryIq info;
+    info.setType(QXmppIq::Get);
+    info.setQueryType(QXmppDiscoveryIq::InfoQuery);
+    info.setTo(jid);
+    m_probes.insert(info.id(), jid);
+    m_sentAt.insert(info.id(), m_clock.elapsed());
+    m_client->sendPacket(info);
+
+    if (!m_expireTimer->isActive())
+        m_expireTimer->start();
+}
+
+void ProxySelector::discoveryIqReceived(const QXmppDiscoveryIq &iq)
+{
+    if (iq.id() == m_itemsRequest) {
+        m_itemsRequest.clear();
+        foreach (const QXmppDiscoveryIq::Item &item, iq.items()) {
+            probe(item.jid());
+        }
+        return;
+    }
+
+    if (!m_probes.contains(iq.id()))
+        return;
+
+    QString jid = m_probes.take(iq.id());
+    qint64 latency = m_clock.elapsed() - m_sentAt.take(iq.id());
+    if (iq.type() != QXmppIq::Result)
+        return;
+
+    foreach (const QXmppDiscoveryIq::Identity &identity, iq.identities()) {
+        if (identity.category() == "proxy" && identity.type() == "bytestreams") {
+            LOG_INFO(QString("[ProxySelector] %1 answered in %2 ms").arg(jid).arg(latency));
+            m_latencies.insert(jid, latency);
+            select();
+            break;
+        }
+    }
+}
+
+void ProxySelector::expireProbes()
+{
+    // whoever did not answer in time is not a candidate this round
+    qint64 now = m_clock.elapsed();
+    QHash<QString, qint64>::iterator it = m_sentAt.begin();
+    while (it != m_sentAt.end()) {
+        if (now - it.value() >= ProbeTimeout) {
+            LOG_INFO(QString("[ProxySelector] %1 did not answer").arg(m_probes.value(it.key())));
+            m_probes.remove(it.key());
+            it = m_sentAt.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!m_sentAt.isEmpty())
+        m_expireTimer->start();
+    else
+        select(); // round over, drop a proxy that stopped answering
+}
+
+void ProxySelector::select()
+{
+    QString best;
+    qint64 bestLatency = 0;
+    QHash<QString, qint64>::const_iterator it;
+    for (it = m_latencies.constBegin(); it != m_latencies.constEnd(); ++it) {
+        if (best.isEmpty() || it.value() < bestLatency) {
+            best = it.key();
+            bestLatency = it.value();
+        }
+    }
+
+    // per account, each has its own server and proxies; -1 is no proxy
+    Metrics::gauge("transfer.proxy.latency." + m_client->getConfiguration().jidBare())
+            = best.isEmpty() ? -1 : bestLatency;
+    if (best == m_current)
+        return;
+
+    m_current = best;
+    m_client->getTransferManager().setProxy(m_current);
+    LOG_INFO(QString("[ProxySelector] using %1").arg(m_current));
+    emit proxyChanged(m_current);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROXYSELECTOR_H
+#define PROXYSELECTOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QElapsedTimer>
+
+class QTimer;
+class QXmppClient;
+class QXmppDiscoveryIq;
+
+// Picks the SOCKS5 bytestream proxy for file transfers. Candidates are the
+// proxies found with disco#items/disco#info on our own server plus the ones
+// from the preferences; each is timed with a disco#info round trip in the
+// background and the fastest one answering is handed to the transfer
+// manager. Refreshed on every login and every ten minutes.
+class ProxySelector : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ProxySelector(QXmppClient *client, QObject *parent = 0);
+    void setConfiguredProxies(const QStringList &jids);
+    QString currentProxy() const;
+
+public slots:
+    void refresh();
+
+signals:
+    void proxyChanged(const QString &jid);
+
+private slots:
+    void discoveryIqReceived(const QXmppDiscoveryIq &iq);
+    void expireProbes();
+
+private:
+    QXmppClient *m_client;
+    QStringList m_configured;
+    QString m_itemsRequest;
+    QHash<QString, QString> m_probes; // iq id -> proxy jid
+    QHash<QString, qint64> m_sentAt; // iq id -> m_clock msecs
+    QHash<QString, qint64> m_latencies; // proxy jid -> msecs
+    QElapsedTimer m_clock;
+    QString m_current;
+    QTimer *m_refreshTimer;
+    QTimer *m_expireTimer;
+
+    void probe(const QString &jid);
+    void select();
+};
+
+#endif // PROXYSELECTOR_H
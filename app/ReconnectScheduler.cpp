@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ReconnectScheduler.h"
+#include <QDateTime>
+#include <QTimer>
+#if QT_VERSION >= 0x040700
+#include <QNetworkConfigurationManager>
+#endif
+
+static const int BaseDelay = 2000;
+static const int MaxDelay = 300000;
+static const int OnlineDelay = 3000;
+
+ReconnectScheduler::ReconnectScheduler(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this)),
+    m_attempts(0),
+    m_delay(0),
+    m_pending(false),
+    m_online(true)
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(timeout()) );
+
+    qsrand(uint(QDateTime::currentDateTime().toTime_t()) ^ uint(quintptr(this)));
+
+#if QT_VERSION >= 0x040700
+    QNetworkConfigurationManager *manager = new QNetworkConfigurationManager(this);
+    m_online = manager->isOnline();
+    connect(manager, SIGNAL(onlineStateChanged(bool)),
+            this, SLOT(onlineStateChanged(bool)) );
+#endif
+}
+
+void ReconnectScheduler::schedule()
+{
+    if (m_pending)
+        return;
+
+    m_pending = true;
+    m_delay = backoff();
+    m_attempts++;
+    if (m_online)
+        m_timer->start(m_delay);
+}
+
+void ReconnectScheduler::reset()
+{
+    m_timer->stop();
+    m_pending = false;
+    m_attempts = 0;
+    m_delay = 0;
+}
+
+void ReconnectScheduler::cancel()
+{
+    reset();
+}
+
+bool ReconnectScheduler::isScheduled() const
+{
+    return m_pending;
+}
+
+int ReconnectScheduler::attempts() const
+{
+    return m_attempts;
+}
+
+int ReconnectScheduler::nextDelay() const
+{
+    return m_delay;
+}
+
+void ReconnectScheduler::timeout()
+{
+    m_pending = false;
+    emit reconnect();
+}
+
+void ReconnectScheduler::onlineStateChanged(bool online)
+{
+    m_online = online;
+    if (!m_pending)
+        return;
+
+    if (!online) {
+        // no point in trying, wait for the network to come back
+        m_timer->stop();
+    } else {
+        // the network is back, try soon but still spread the clients
+        m_attempts = 0;
+        m_delay = OnlineDelay / 2 + qrand() % (OnlineDelay / 2);
+        m_timer->start(m_delay);
+    }
+}
+
+// half of the delay is fixed, the other half random
+int ReconnectScheduler::backoff() const
+{
+    int delay = BaseDelay;
+    for (int i = 0; i < m_attempts && delay < MaxDelay; i++)
+        delay *= 2;
+    delay = qMin(delay, MaxDelay);
+    return delay / 2 + qrand() % (delay / 2 + 1);
+}
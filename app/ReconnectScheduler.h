@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef RECONNECTSCHEDULER_H
+#define RECONNECTSCHEDULER_H
+
+#include <QObject>
+
+class QTimer;
+
+// Decide when to try again after the connection is lost: capped exponential
+// backoff with jitter, so clients dropped together do not come back in
+// lockstep. Attempts wait while the network is known to be down.
+class ReconnectScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReconnectScheduler(QObject *parent = 0);
+    void schedule(); // plan the next attempt, nothing happens if one is planned
+    void reset();    // connected, start again from the shortest delay
+    void cancel();   // the user went offline, stop trying
+    bool isScheduled() const;
+    int attempts() const;
+    int nextDelay() const; // msecs until the planned attempt
+
+signals:
+    void reconnect();
+
+private slots:
+    void timeout();
+    void onlineStateChanged(bool online);
+
+private:
+    QTimer *m_timer;
+    int m_attempts;
+    int m_delay;
+    bool m_pending;
+    bool m_online;
+
+    int backoff() const;
+};
+
+#endif // RECONNECTSCHEDULER_H
@@ -31,6 +31,18 @@
 #include "QXmppVCard.h"
 #include <QIcon>
 #include <QXmppRosterIq.h>
+#include "VCardCache.h"
+#include "IconCache.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "StallWatchdog.h"
+#include <QTimer>
+
+// time given to the presences of a new session before stale resources go
+static const int PresenceGrace = 10000;
+// a batch is what one turn of the event loop delivered, the rest of a
+// larger burst waits for the next turn
+static const int PresenceBatchSize = 500;
 
 class TreeItem
 {
@@ -46,7 +58,8 @@ public:
     int childNumber() const;
     RosterModel::ItemType type() const { return m_type; }
     QList<TreeItem *> childItems() const { return m_childItems; }
-    void sortChildren();
+    int childIndexOf(TreeItem *child, int from = 0) const { return m_childItems.indexOf(child, from); }
+    void moveChild(int from, int to) { m_childItems.move(from, to); }
     void setUnread(bool unread = true);
     bool isUnread() const;
     bool hasChlidContain(const QString &data) const;
@@ -63,16 +76,12 @@ private:
     QList<TreeItem *> onlineChildItems() const; // only use for group
 };
 
+// contacts with more resources first. used with a stable sort, so contacts
+// with as many resources keep their order and a sort only moves the ones
+// whose resources changed
 bool TreeItemCompare(TreeItem *s1, TreeItem *s2)
 {
-    if (s1->type() == RosterModel::contact && s2->type() == RosterModel::contact) {
-        //return s1->childCount() >= s2->childCount();
-        if (s1->childCount() == s2->childCount())
-            return s1 < s2;
-        else
-            return s1->childCount() >= s2->childCount();
-    }
-    return true;
+    return s1->childCount() > s2->childCount();
 }
 
 TreeItem::TreeItem(RosterModel::ItemType type, QString data, TreeItem *parent)
@@ -144,11 +153,6 @@ QList<TreeItem *> TreeItem::onlineChildItems() const
     return items;
 }
 
-void TreeItem::sortChildren()
-{
-    qSort(m_childItems.begin(), m_childItems.end(), TreeItemCompare);
-}
-
 void TreeItem::setUnread(bool unread)
 {
     m_unread = unread;
@@ -200,10 +204,26 @@ void TreeItem::clear()
 RosterModel::RosterModel(QXmppClient *client, QObject *parent) :
     QAbstractItemModel(parent),
     m_hideOffline(false),
-    m_showResources(false)
+    m_showResources(false),
+    m_hiddenChanged(false)
 {
     setClient(client);
     m_rootItem = new TreeItem(root, "root");
+
+    m_presenceTimer = new QTimer(this);
+    // no delay: the presences parsed from one read of the socket are
+    // applied together, right after it
+    m_presenceTimer->setSingleShot(true);
+    m_presenceTimer->setInterval(0);
+    connect(m_presenceTimer, SIGNAL(timeout()),
+            this, SLOT(applyPendingPresences()) );
+
+    connect(this, SIGNAL(rowsInserted(QModelIndex,int,int)),
+            this, SLOT(countRowsInserted(QModelIndex,int,int)) );
+    connect(this, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+            this, SLOT(countRowsRemoved(QModelIndex,int,int)) );
+    connect(this, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+            this, SLOT(countRowsMoved()) );
 }
 
 RosterModel::~RosterModel()
@@ -249,9 +269,9 @@ void RosterModel::insertRosterToGroup(QString bareJid, QString group)
     QModelIndex groupIndex = findOrCreateGroup(group);
     TreeItem *groupItem = getItem(groupIndex);
     if (groupItem->hasChlidContain(bareJid)) {
-        qDebug() << QString("[RosterModel] Exist %1 in group %2").arg(bareJid).arg(group);
+        LOG_DEBUG(QString("[RosterModel] Exist %1 in group %2").arg(bareJid).arg(group));
     } else {
-        qDebug() << QString("[RosterModel] Insert %1 to group %2").arg(bareJid).arg(group);
+        LOG_DEBUG(QString("[RosterModel] Insert %1 to group %2").arg(bareJid).arg(group));
         int row = rowCount(groupIndex);
         beginInsertRows(groupIndex, row, row);
         TreeItem *contactItem = new TreeItem(contact, bareJid, groupItem);
@@ -266,7 +286,7 @@ void RosterModel::insertRosterToGroup(QString bareJid, QString group)
 void RosterModel::removeRosterFromGroup(QString bareJid, QString group)
 {
     if (m_rootItem->hasChlidContain(group)) {
-        qDebug() << QString("[RosterModel] Remove %1 from %2").arg(bareJid).arg(group);
+        LOG_DEBUG(QString("[RosterModel] Remove %1 from %2").arg(bareJid).arg(group));
         QModelIndex groupIndex = groupIndexFor(group);
         TreeItem *groupItem = getItem(groupIndex);
         if (groupItem->hasChlidContain(bareJid)) {
@@ -308,14 +328,45 @@ void RosterModel::setClient(QXmppClient *client)
              this, SLOT(rosterChangedSlot(QString)) );
     connect(m_vCardManager, SIGNAL(vCardReceived(const QXmppVCard&)),
             this, SLOT(vCardRecived(const QXmppVCard&)) );
+    // other accounts may receive the vcard of a shared contact
+    connect(VCardCache::instance(), SIGNAL(vCardChanged(QString)),
+            this, SLOT(vCardChanged(QString)) );
+}
+
+void RosterModel::countRowsInserted(const QModelIndex &, int start, int end)
+{
+    static qint64 &inserted = Metrics::counter("roster.rows.inserted");
+    inserted += end - start + 1;
+}
+
+void RosterModel::countRowsRemoved(const QModelIndex &, int start, int end)
+{
+    static qint64 &removed = Metrics::counter("roster.rows.removed");
+    removed += end - start + 1;
+}
+
+void RosterModel::countRowsMoved()
+{
+    static qint64 &moved = Metrics::counter("roster.rows.moved");
+    moved++;
 }
 
 void RosterModel::parseRoster()
 {
+    StallScope stallScope("RosterModel::parseRoster");
+
+    // on reconnect, only apply the difference to the existing tree
+    if (m_rootItem->childCount() != 0) {
+        reconcileRoster();
+        emit parseDone();
+        return;
+    }
+
     initNoGroup();
 
     foreach (QString bareJid, m_roster->getRosterBareJids()) {
         QXmppRoster::QXmppRosterEntry entry = m_roster->getRosterEntry(bareJid);
+        m_rosterNames.insert(bareJid, entry.name());
         if (entry.groups().isEmpty()) {
             TreeItem *item = new TreeItem(contact, bareJid, m_noGroupItem);
             m_noGroupItem->appendChild(item);
@@ -337,10 +388,147 @@ void RosterModel::parseRoster()
     emit parseDone();
 }
 
+void RosterModel::reconcileRoster()
+{
+    // <group, bareJids> as the server sees it now
+    QMap<QString, QSet<QString> > wanted;
+    QHash<QString, QString> names;
+    wanted[m_noGroupItem->data()] = QSet<QString>();
+    foreach (QString bareJid, m_roster->getRosterBareJids()) {
+        QXmppRoster::QXmppRosterEntry entry = m_roster->getRosterEntry(bareJid);
+        names.insert(bareJid, entry.name());
+        QSet<QString> groups = entry.groups();
+        if (groups.isEmpty())
+            groups << m_noGroupItem->data();
+        foreach (QString groupName, groups) {
+            wanted[groupName] << bareJid;
+        }
+    }
+
+    // remove what is gone, from the bottom so the rows above stay valid.
+    // what remains in wanted afterwards is new.
+    QSet<TreeItem *> countChanged; // groups whose counters need a repaint
+    for (int row = m_rootItem->childCount() - 1; row >= 0; row--) {
+        TreeItem *groupItem = m_rootItem->child(row);
+        if (!wanted.contains(groupItem->data())) {
+            removeRow(row);
+            continue;
+        }
+
+        QModelIndex groupIndex = createIndex(row, 0, groupItem);
+        QSet<QString> &bareJids = wanted[groupItem->data()];
+        for (int contactRow = groupItem->childCount() - 1; contactRow >= 0; contactRow--) {
+            QString bareJid = groupItem->child(contactRow)->data();
+            if (bareJids.contains(bareJid)) {
+                bareJids.remove(bareJid);
+                // only a renamed contact is repainted
+                if (names.value(bareJid) != m_rosterNames.value(bareJid)) {
+                    QModelIndex contactIndex = index(contactRow, 0, groupIndex);
+                    emit dataChanged(contactIndex, contactIndex);
+                }
+            } else {
+                removeRow(contactRow, groupIndex);
+                countChanged.insert(groupItem);
+            }
+        }
+    }
+    m_rosterNames = names;
+
+    QMap<QString, QSet<QString> >::const_iterator it;
+    for (it = wanted.constBegin(); it != wanted.constEnd(); ++it) {
+        if (it.value().isEmpty())
+            continue;
+
+        QModelIndex groupIndex = findOrCreateGroup(it.key());
+        TreeItem *groupItem = getItem(groupIndex);
+        int first = groupItem->childCount();
+        beginInsertRows(groupIndex, first, first + it.value().count() - 1);
+        foreach (QString bareJid, it.value()) {
+            groupItem->appendChild(new TreeItem(contact, bareJid, groupItem));
+        }
+        endInsertRows();
+
+        for (int row = first; row < groupItem->childCount(); row++) {
+            checkRosources(createIndex(row, 0, groupItem->child(row)));
+        }
+        countChanged.insert(groupItem);
+        sortContact(groupIndex);
+    }
+
+    foreach (TreeItem *groupItem, countChanged) {
+        QModelIndex groupIndex = createIndex(groupItem->childNumber(), 0, groupItem);
+        emit dataChanged(groupIndex, groupIndex);
+    }
+    emit hiddenUpdate();
+
+    QTimer::singleShot(PresenceGrace, this, SLOT(reconcileResources()));
+}
+
+void RosterModel::reconcileResources()
+{
+    StallScope stallScope("RosterModel::reconcileResources");
+
+    for (int row = 0; row < m_rootItem->childCount(); row++) {
+        TreeItem *groupItem = m_rootItem->child(row);
+        bool changed = false;
+        for (int contactRow = 0; contactRow < groupItem->childCount(); contactRow++) {
+            TreeItem *contactItem = groupItem->child(contactRow);
+            if (contactItem->childCount() == 0)
+                continue;
+
+            QModelIndex contactIndex = createIndex(contactRow, 0, contactItem);
+            QStringList resources = m_roster->getResources(contactItem->data());
+            int count = contactItem->childCount();
+            for (int resourceRow = count - 1; resourceRow >= 0; resourceRow--) {
+                if (!resources.contains(contactItem->child(resourceRow)->data()))
+                    removeRow(resourceRow, contactIndex);
+            }
+            if (contactItem->childCount() != count) {
+                emit dataChanged(contactIndex, contactIndex);
+                changed = true;
+            }
+        }
+        if (changed)
+            sortContact(createIndex(row, 0, groupItem));
+    }
+    emit hiddenUpdate();
+}
+
+void RosterModel::setAllOffline()
+{
+    for (int row = 0; row < m_rootItem->childCount(); row++) {
+        TreeItem *groupItem = m_rootItem->child(row);
+        bool changed = false;
+        for (int contactRow = 0; contactRow < groupItem->childCount(); contactRow++) {
+            TreeItem *contactItem = groupItem->child(contactRow);
+            if (contactItem->childCount() == 0)
+                continue;
+
+            QModelIndex contactIndex = createIndex(contactRow, 0, contactItem);
+            beginRemoveRows(contactIndex, 0, contactItem->childCount() - 1);
+            contactItem->clear();
+            endRemoveRows();
+            emit dataChanged(contactIndex, contactIndex);
+            changed = true;
+        }
+        // a group that was all offline already keeps its order
+        if (changed) {
+            QModelIndex groupIndex = createIndex(row, 0, groupItem);
+            emit dataChanged(groupIndex, groupIndex);
+            sortContact(groupIndex);
+        }
+    }
+    emit hiddenUpdate();
+}
+
 void RosterModel::vCardRecived(const QXmppVCard &vCard)
 {
-    m_vCards[vCard.from()] = vCard;
-    foreach (QModelIndex index, indexsForBareJid(vCard.from())) {
+    VCardCache::instance()->insert(vCard);
+}
+
+void RosterModel::vCardChanged(const QString &bareJid)
+{
+    foreach (QModelIndex index, indexsForBareJid(bareJid)) {
         dataChanged(index, index);
     }
 }
@@ -386,21 +574,19 @@ QVariant RosterModel::data(const QModelIndex &index, int role) const
 
     if (role == Qt::DecorationRole) {
         if (type == group) {
-            QImage image(":/images/folder.png");
-            return QIcon(QPixmap::fromImage(image.scaled(QSize(24, 24))));
+            return IconCache::scaledIcon(":/images/folder.png", QSize(24, 24));
         } else if (type == contact) {
             if (item->isUnread()) {
-                return QIcon(":/images/mail-unread-new.png");
+                return IconCache::icon(":/images/mail-unread-new.png");
             }
-            if (m_vCards.contains(jidAt(index))
-                && !m_vCards[jidAt(index)].photoAsImage().isNull()) {
-                QImage image = m_vCards[jidAt(index)].photoAsImage().scaled(QSize(64, 64));
-                return QIcon(QPixmap::fromImage(image));
+            QIcon avatar = VCardCache::instance()->avatar(item->data());
+            if (!avatar.isNull()) {
+                return avatar;
             } else {
                 if (item->childCount() == 0)
-                    return QIcon(":/images/user-identity-grey.png");
+                    return IconCache::icon(":/images/user-identity-grey.png");
                 else
-                    return QIcon(":/images/user-identity.png");
+                    return IconCache::icon(":/images/user-identity.png");
             }
         } else {
             return QVariant();
@@ -448,6 +634,51 @@ int RosterModel::columnCount(const QModelIndex & /* parent */) const
 
 void RosterModel::presenceChangedSlot(const QString &bareJid, const QString &resource)
 {
+    static qint64 &coalesced = Metrics::counter("roster.presence.coalesced");
+
+    // the roster holds the latest presence, applying it once is enough
+    QString key = bareJid + '/' + resource;
+    if (m_pendingKeys.contains(key)) {
+        coalesced++;
+        return;
+    }
+    m_pendingKeys.insert(key);
+    m_pendingPresences.append(qMakePair(bareJid, resource));
+    if (!m_presenceTimer->isActive())
+        m_presenceTimer->start();
+}
+
+void RosterModel::applyPendingPresences()
+{
+    StallScope stallScope("RosterModel::applyPendingPresences");
+    static Histogram &latency = Metrics::histogram("roster.presenceBatch");
+    ScopedLatency scope(latency);
+
+    for (int i = 0; i < PresenceBatchSize && !m_pendingPresences.isEmpty(); i++) {
+        QPair<QString, QString> pending = m_pendingPresences.takeFirst();
+        m_pendingKeys.remove(pending.first + '/' + pending.second);
+        applyPresence(pending.first, pending.second);
+    }
+
+    // sorted and re-hidden once for the whole batch
+    foreach (TreeItem *groupItem, m_unsortedGroups) {
+        sortContact(createIndex(groupItem->childNumber(), 0, groupItem));
+    }
+    m_unsortedGroups.clear();
+    if (m_hiddenChanged) {
+        m_hiddenChanged = false;
+        emit hiddenUpdate();
+    }
+
+    if (!m_pendingPresences.isEmpty())
+        m_presenceTimer->start();
+}
+
+void RosterModel::applyPresence(const QString &bareJid, const QString &resource)
+{
+    static Histogram &latency = Metrics::histogram("roster.presenceChanged");
+    ScopedLatency scope(latency);
+
     QXmppPresence presence = m_roster->getPresence(bareJid, resource);
     //QXmppRoster::QXmppRosterEntry entry = m_roster->getRosterEntry(bareJid);
 
@@ -457,28 +688,31 @@ void RosterModel::presenceChangedSlot(const QString &bareJid, const QString &res
     }
 
     // request vcard if no exist
-    if (!m_vCards.contains(bareJid)) {
+    if (!VCardCache::instance()->contains(bareJid)) {
         m_vCardManager->requestVCard(bareJid);
     }
 }
 
 void RosterModel::rosterChangedSlot(const QString &bareJid)
 {
+    StallScope stallScope("RosterModel::rosterChangedSlot");
+
     /*
      * new contact    : add new contact to it's groups, if no group, add to "No Group" group
      * remove contact : remove all contact in groups
      * contact groups changed : remove group no exist, add to new group
      */
     QList<QModelIndex> indexs = indexsForBareJid(bareJid);
+    QXmppRoster::QXmppRosterEntry entry = m_roster->getRosterEntry(bareJid);
+    m_rosterNames.insert(bareJid, entry.name());
     if (indexs.isEmpty()) {
-        qDebug() << QString("[RosterModel] Add New roster: ") << bareJid;
+        LOG_DEBUG(QString("[RosterModel] Add New roster: %1").arg(bareJid));
         newContact(bareJid);
     } else {
-        QXmppRoster::QXmppRosterEntry entry = m_roster->getRosterEntry(bareJid);
-
         if (entry.subscriptionType() == QXmppRoster::QXmppRosterEntry::Remove) {
             // clear
-            qDebug() << QString("[RosterModel] Clear %1").arg(bareJid);
+            LOG_DEBUG(QString("[RosterModel] Clear %1").arg(bareJid));
+            m_rosterNames.remove(bareJid);
             foreach (QModelIndex index, indexs) {
                 removeRow(index.row(), parent(index));
             }
@@ -499,7 +733,7 @@ void RosterModel::rosterChangedSlot(const QString &bareJid)
 
                 if (groups.contains(group)) {
                     // update a contact in group
-                    qDebug() << QString("[RosterModel] Update %1 in %2").arg(bareJid).arg(group);
+                    LOG_DEBUG(QString("[RosterModel] Update %1 in %2").arg(bareJid).arg(group));
                     dataChanged(index, index);
 
                     // had parse
@@ -561,10 +795,10 @@ void RosterModel::parsePresence(const QModelIndex &contactIndex, const QString &
         foreach (TreeItem *resourceItem, contactItem->childItems()) {
             if (resourceItem->data() == resource) {
                 removeRow(resourceItem->childNumber(), contactIndex);
-                sortContact(groupIndex);
+                m_unsortedGroups.insert(getItem(groupIndex));
             }
         }
-        emit hiddenUpdate();
+        m_hiddenChanged = true;
     } else {
         if (contactItem->hasChlidContain(resource)){
             // update resource
@@ -577,8 +811,8 @@ void RosterModel::parsePresence(const QModelIndex &contactIndex, const QString &
             TreeItem *resourceItem = new TreeItem(RosterModel::resource, resource, contactItem);
             contactItem->appendChild(resourceItem);
             endInsertRows();
-            sortContact(groupIndex);
-            emit hiddenUpdate();
+            m_unsortedGroups.insert(getItem(groupIndex));
+            m_hiddenChanged = true;
         }
     }
     emit dataChanged(contactIndex, contactIndex);
@@ -744,13 +978,22 @@ QString RosterModel::statusTextAt(const QModelIndex &index) const
 
 void RosterModel::sortContact(const QModelIndex &groupIndex)
 {
-    emit layoutAboutToBeChanged();
-    TreeItem *item = getItem(groupIndex);
-
-    if (item->type() == RosterModel::group) {
-        item->sortChildren();
+    TreeItem *groupItem = getItem(groupIndex);
+    if (groupItem->type() != RosterModel::group)
+        return;
+
+    // move only the contacts that change place, inside this group. usually
+    // that is none or one, and the rest of the tree is not relaid out
+    QList<TreeItem *> sorted = groupItem->childItems();
+    qStableSort(sorted.begin(), sorted.end(), TreeItemCompare);
+    for (int row = 0; row < sorted.count(); row++) {
+        int from = groupItem->childIndexOf(sorted.at(row), row);
+        if (from == row)
+            continue;
+        beginMoveRows(groupIndex, from, from, groupIndex, row);
+        groupItem->moveChild(from, row);
+        endMoveRows();
     }
-    emit layoutChanged();
 }
 
 // a message recevie, mark the reaource unread. if resource is unknow, let the contact mark unread
@@ -862,20 +1105,20 @@ bool RosterModel::isIndexHidden(const QModelIndex &index)
 
 bool RosterModel::hasVCard(const QString &bareJid) const
 {
-    return m_vCards.contains(bareJid);
+    return VCardCache::instance()->contains(bareJid);
 }
 
 QXmppVCard RosterModel::getVCard(const QString &bareJid) const
 {
-    if (hasVCard(bareJid))
-        return m_vCards[bareJid];
-    else
-        return QXmppVCard();
+    return VCardCache::instance()->vCard(bareJid);
 }
 
 void RosterModel::clear()
 {
-    m_vCards.clear();
+    m_pendingPresences.clear();
+    m_pendingKeys.clear();
+    m_rosterNames.clear();
+    // vcards live in the shared cache, they stay valid across logins
     m_rootItem->clear();
     reset();
 }
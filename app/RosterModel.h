@@ -28,8 +28,12 @@
 #define ROSTERMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QPair>
+#include <QSet>
 #include "Preferences.h"
 
+class QTimer;
 class TreeItem;
 class QXmppClient;
 class QXmppRoster;
@@ -72,6 +76,7 @@ public:
     bool hasVCard(const QString &bareJid) const;
     QXmppVCard getVCard(const QString &bareJid) const; // if no exist, return empty vcard
     void clear();
+    void setAllOffline(); // drop every resource, keep groups and contacts
     QSet<QString> getGroups() const;
 
 signals:
@@ -84,8 +89,14 @@ public slots:
 
 private slots:
     void presenceChangedSlot(const QString &bareJid, const QString &resource);
+    void applyPendingPresences();
     void rosterChangedSlot(const QString &bareJid);
     void vCardRecived(const QXmppVCard&);
+    void vCardChanged(const QString &bareJid);
+    void reconcileResources();
+    void countRowsInserted(const QModelIndex &, int start, int end);
+    void countRowsRemoved(const QModelIndex &, int start, int end);
+    void countRowsMoved();
 
 private:
     QXmppClient *m_client;
@@ -97,8 +108,18 @@ private:
     bool m_showResources;
     bool m_showSingleResource;
 
+    // presence changes are queued and applied in batches, a contact that
+    // changes again before its turn is only applied once
+    QList<QPair<QString, QString> > m_pendingPresences; // bareJid, resource
+    QSet<QString> m_pendingKeys;
+    QSet<TreeItem *> m_unsortedGroups;
+    QHash<QString, QString> m_rosterNames; // bareJid, roster name as shown
+    bool m_hiddenChanged;
+    QTimer *m_presenceTimer;
+
     void removeRow(int row, const QModelIndex &parent = QModelIndex());
     void initNoGroup();
+    void reconcileRoster();
     void setClient(QXmppClient *client);
     QModelIndex findOrCreateGroup(QString group);
     QModelIndex groupIndexFor(const QString &groupName) const;
@@ -108,11 +129,11 @@ private:
     bool hasGroup(const QString &groupName) const;
     void newContact(const QString &bareJid);
     void checkRosources(const QModelIndex &index);
+    void applyPresence(const QString &bareJid, const QString &resource);
     void parsePresence(const QModelIndex &contactIndex, const QString &resource, const QXmppPresence &presence);
     TreeItem* getItem(const QModelIndex &index) const;
     void sortContact(const QModelIndex &groupIndex);
     QList<QModelIndex> indexsForBareJid(const QString &bareJid); // include all resource
-    QMap<QString, QXmppVCard> m_vCards; // <bareJid, vcard>
 
     // use for data display
     QString displayData(const QModelIndex &index) const;
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RotatingFile.h"
+#include <QDir>
+#include <QFileInfo>
+
+RotatingFile::RotatingFile(const QString &fileName, qint64 maxSize, int maxFiles) :
+    m_file(fileName),
+    m_maxSize(maxSize),
+    m_maxFiles(maxFiles)
+{
+}
+
+RotatingFile::~RotatingFile()
+{
+    close();
+}
+
+bool RotatingFile::open()
+{
+    if (m_file.isOpen())
+        return true;
+
+    QDir().mkpath(QFileInfo(m_file.fileName()).absolutePath());
+    return m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void RotatingFile::close()
+{
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+bool RotatingFile::write(const QByteArray &data)
+{
+    if (!m_file.isOpen() && !open())
+        return false;
+
+    if (m_file.size() + data.size() > m_maxSize && m_file.size() > 0) {
+        rotate();
+        if (!open())
+            return false;
+    }
+    return m_file.write(data) == data.size();
+}
+
+void RotatingFile::flush()
+{
+    if (m_file.isOpen())
+        m_file.flush();
+}
+
+QString RotatingFile::fileName() const
+{
+    return m_file.fileName();
+}
+
+void RotatingFile::rotate()
+{
+    close();
+
+    // name.(n-1) -> name.n ... name -> name.1, the oldest falls off
+    QString name = m_file.fileName();
+    QFile::remove(QString("%1.%2").arg(name).arg(m_maxFiles));
+    for (int i = m_maxFiles - 1; i >= 1; i--) {
+        QFile::rename(QString("%1.%2").arg(name).arg(i),
+                      QString("%1.%2").arg(name).arg(i + 1));
+    }
+    if (m_maxFiles > 0)
+        QFile::rename(name, name + ".1");
+    else
+        QFile::remove(name);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ROTATINGFILE_H
+#define ROTATINGFILE_H
+
+#include <QFile>
+#include <QString>
+
+// Append-only file that moves itself to name.1, name.2 ... once it grows
+// past maxSize, keeping at most maxFiles old copies. Not thread safe, give
+// each writer thread its own.
+class RotatingFile
+{
+public:
+    RotatingFile(const QString &fileName, qint64 maxSize = 1024 * 1024, int maxFiles = 3);
+    ~RotatingFile();
+
+    bool open();
+    void close();
+    bool write(const QByteArray &data);
+    void flush();
+    QString fileName() const;
+
+private:
+    QFile m_file;
+    qint64 m_maxSize;
+    int m_maxFiles;
+
+    void rotate();
+};
+
+#endif // ROTATINGFILE_H
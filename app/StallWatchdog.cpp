@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "StallWatchdog.h"
+#include "RotatingFile.h"
+#include "Logger.h"
+#include <QDateTime>
+#include <QStringList>
+#include <QTimer>
+
+#if defined(Q_OS_LINUX)
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#endif
+
+const char *volatile StallScope::s_current = 0;
+
+static const int HeartbeatInterval = 100;
+
+#if defined(Q_OS_LINUX)
+static const int MaxFrames = 64;
+static void *s_frames[MaxFrames];
+static volatile sig_atomic_t s_frameCount = 0;
+static volatile sig_atomic_t s_captured = 0;
+static pthread_t s_guiThread;
+
+// runs on the GUI thread, interrupted wherever it is stuck
+static void captureBacktrace(int)
+{
+    s_frameCount = backtrace(s_frames, MaxFrames);
+    s_captured = 1;
+}
+#endif
+
+StallWatchdog::StallWatchdog(int thresholdMsecs, QObject *parent) :
+    QThread(parent),
+    m_timer(new QTimer(this)),
+    m_lastBeat(0),
+    m_running(0),
+    m_threshold(thresholdMsecs)
+{
+    m_timer->setInterval(HeartbeatInterval);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(heartbeat()) );
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    stop();
+}
+
+void StallWatchdog::start(const QString &fileName)
+{
+    if (m_running)
+        return;
+
+    m_fileName = fileName;
+    m_clock.start();
+    m_lastBeat = 0;
+    m_running = 1;
+
+#if defined(Q_OS_LINUX)
+    s_guiThread = pthread_self();
+    // the first backtrace() loads libgcc, never do that inside the handler
+    void *warmup[1];
+    backtrace(warmup, 1);
+
+    struct sigaction action;
+    action.sa_handler = captureBacktrace;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &action, 0);
+#endif
+
+    m_timer->start();
+    QThread::start(QThread::LowPriority);
+}
+
+void StallWatchdog::stop()
+{
+    if (!m_running)
+        return;
+
+    m_timer->stop();
+    m_running = 0;
+    wait();
+}
+
+void StallWatchdog::heartbeat()
+{
+    m_lastBeat = int(m_clock.elapsed());
+}
+
+int StallWatchdog::msecsSince(int beat) const
+{
+    return int(m_clock.elapsed()) - beat;
+}
+
+QStringList StallWatchdog::backtraceOfGuiThread()
+{
+    QStringList frames;
+#if defined(Q_OS_LINUX)
+    s_captured = 0;
+    if (pthread_kill(s_guiThread, SIGUSR2) != 0)
+        return frames;
+
+    for (int i = 0; i < 20 && !s_captured; i++) {
+        msleep(5);
+    }
+    if (!s_captured)
+        return frames;
+
+    char **symbols = backtrace_symbols(s_frames, s_frameCount);
+    if (symbols == 0)
+        return frames;
+
+    // skip the handler and the signal trampoline
+    for (int i = 2; i < s_frameCount; i++) {
+        frames << QString::fromLocal8Bit(symbols[i]);
+    }
+    free(symbols);
+#endif
+    return frames;
+}
+
+void StallWatchdog::run()
+{
+    RotatingFile file(m_fileName, 512 * 1024, 3);
+    bool stalled = false;
+    int stallBeat = 0;
+
+    while (m_running) {
+        msleep(HeartbeatInterval / 2);
+
+        int beat = m_lastBeat;
+        int late = msecsSince(beat);
+        if (!stalled && late > m_threshold) {
+            stalled = true;
+            stallBeat = beat;
+
+            const char *scope = StallScope::current();
+            QString scopeName = scope ? QString::fromLatin1(scope) : QString("(unknown)");
+            QStringList lines;
+            lines << QString("%1 stall over %2 ms in %3")
+                     .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz"))
+                     .arg(m_threshold).arg(scopeName);
+            foreach (QString frame, backtraceOfGuiThread()) {
+                lines << "    " + frame;
+            }
+            file.write((lines.join("\n") + "\n").toLocal8Bit());
+            file.flush();
+            LOG_WARNING(QString("[StallWatchdog] event loop stalled in %1").arg(scopeName));
+        } else if (stalled && beat != stallBeat) {
+            stalled = false;
+            int duration = beat - stallBeat - HeartbeatInterval;
+            file.write(QString("    ended after about %1 ms\n").arg(duration).toLocal8Bit());
+            file.flush();
+        }
+    }
+}
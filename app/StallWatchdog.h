@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QString>
+
+class QTimer;
+
+// Watches the GUI event loop from its own thread. A timer in the GUI thread
+// beats every 100 ms; when a beat is later than the threshold the stall is
+// written to a rotating file with the StallScope that was running and, on
+// Linux, a backtrace of the GUI thread taken from a signal handler.
+class StallWatchdog : public QThread
+{
+    Q_OBJECT
+public:
+    explicit StallWatchdog(int thresholdMsecs = 500, QObject *parent = 0);
+    ~StallWatchdog();
+
+    void start(const QString &fileName); // call from the GUI thread
+    void stop();
+
+protected:
+    void run();
+
+private slots:
+    void heartbeat();
+
+private:
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+    QAtomicInt m_lastBeat; // m_clock msecs, compared modulo 2^32
+    QAtomicInt m_running;
+    int m_threshold;
+    QString m_fileName;
+
+    int msecsSince(int beat) const;
+    QStringList backtraceOfGuiThread();
+};
+
+// Names the slot being dispatched on the GUI thread for stall reports.
+// Only takes string literals, nests.
+class StallScope
+{
+public:
+    explicit StallScope(const char *name) : m_previous(s_current) { s_current = name; }
+    ~StallScope() { s_current = m_previous; }
+    static const char *current() { return s_current; }
+
+private:
+    const char *m_previous;
+    static const char *volatile s_current;
+};
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "StartupTrace.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QStringList>
+#include <cstdio>
+
+struct Phase
+{
+    QString name;
+    qint64 elapsed;
+};
+
+static QElapsedTimer &timer()
+{
+    static QElapsedTimer elapsedTimer;
+    return elapsedTimer;
+}
+
+static QList<Phase> &phases()
+{
+    static QList<Phase> list;
+    return list;
+}
+
+static bool s_enabled = false;
+static int s_dumped = 0;
+
+static QString formatPhase(int i)
+{
+    const Phase &phase = phases().at(i);
+    qint64 delta = i == 0 ? phase.elapsed : phase.elapsed - phases().at(i - 1).elapsed;
+    return QString("%1 ms (+%2) %3").arg(phase.elapsed, 6).arg(delta, 4).arg(phase.name);
+}
+
+void StartupTrace::start()
+{
+    timer().start();
+    phases().clear();
+    s_dumped = 0;
+    mark("start");
+}
+
+void StartupTrace::mark(const QString &phase)
+{
+    if (!timer().isValid())
+        timer().start();
+
+    Phase entry;
+    entry.name = phase;
+    entry.elapsed = timer().elapsed();
+    phases() << entry;
+}
+
+void StartupTrace::setEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool StartupTrace::isEnabled()
+{
+    return s_enabled;
+}
+
+QString StartupTrace::report()
+{
+    QStringList lines;
+    for (int i = 0; i < phases().count(); i++) {
+        lines << formatPhase(i);
+    }
+    return lines.join("\n");
+}
+
+void StartupTrace::dump()
+{
+    if (!s_enabled)
+        return;
+
+    for (; s_dumped < phases().count(); s_dumped++) {
+        fprintf(stderr, "[startup] %s\n", qPrintable(formatPhase(s_dumped)));
+    }
+    fflush(stderr);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+// Named phases of the process start with monotonic timestamps. Marks are
+// always recorded (GUI thread only), printing them is asked for with
+// --trace-startup.
+class StartupTrace
+{
+public:
+    static void start();
+    static void mark(const QString &phase);
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static QString report();
+    static void dump(); // print the phases not printed yet to stderr
+};
+
+#endif // STARTUPTRACE_H
@@ -25,10 +25,35 @@
  */
 
 #include "TransferManagerModel.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "StallWatchdog.h"
+#include "OutgoingHash.h"
+#include <QTimer>
+
+// progress may be signalled per chunk, repaint at most this often
+static const int ProgressRepaintInterval = 250;
+static const int RateInterval = 1000;
 
 TransferManagerModel::TransferManagerModel(QObject *parent) :
-    QAbstractTableModel(parent)
+    QAbstractTableModel(parent),
+    m_repaintTimer(new QTimer(this)),
+    m_rateTimer(new QTimer(this)),
+    m_dirtyFirst(-1),
+    m_dirtyLast(-1),
+    m_rateGauge("transfer.rate"),
+    m_socksRateGauge("transfer.rate.socks"),
+    m_ibbRateGauge("transfer.rate.ibb"),
+    m_activeGauge("transfer.active")
 {
+    m_clock.start();
+    m_repaintTimer->setSingleShot(true);
+    m_repaintTimer->setInterval(ProgressRepaintInterval);
+    connect(m_repaintTimer, SIGNAL(timeout()),
+            this, SLOT(repaintProgress()) );
+    m_rateTimer->setInterval(RateInterval);
+    connect(m_rateTimer, SIGNAL(timeout()),
+            this, SLOT(updateRates()) );
 }
 
 int TransferManagerModel::rowCount(const QModelIndex &/* parent */) const
@@ -38,7 +63,7 @@ int TransferManagerModel::rowCount(const QModelIndex &/* parent */) const
 
 int TransferManagerModel::columnCount(const QModelIndex &/* parent */) const
 {
-    return 7;
+    return 10;
 }
 
 QVariant TransferManagerModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -60,6 +85,12 @@ QVariant TransferManagerModel::headerData(int section, Qt::Orientation orientati
                 return QString(tr("File Size"));
             case Progress:
                 return QString(tr("Process"));
+            case Speed:
+                return QString(tr("Speed"));
+            case Eta:
+                return QString(tr("ETA"));
+            case Checksum:
+                return QString(tr("Checksum"));
             default:
                 break;
             }
@@ -117,10 +148,34 @@ QVariant TransferManagerModel::data(const QModelIndex &index, int role) const
         case FileSize:
             return job->fileSize();
         case Progress:
-            return QString(" %1 / %2 ").arg(m_doneSize[index.row()]).arg(job->fileSize());
+            return QString(" %1 / %2 ").arg(m_doneSize.value(job)).arg(job->fileSize());
+        case Speed:
+            if (job->state() != QXmppTransferJob::TransferState)
+                return QVariant();
+            return formatRate(m_rates.value(job).rate());
+        case Eta:
+            if (job->state() != QXmppTransferJob::TransferState)
+                return QVariant();
+            return formatEta(m_rates.value(job).eta(job->fileSize() - m_doneSize.value(job)));
+        case Checksum:
+            switch (m_checksums.value(job, ChecksumPending)) {
+            case ChecksumPending:
+                return QVariant();
+            case ChecksumVerified:
+                return QString(tr("Verified"));
+            case ChecksumMismatch:
+                return QString(tr("Mismatch"));
+            case ChecksumUnavailable:
+                return QString(tr("No hash"));
+            }
+            break;
         default:
             break;
         }
+    } else if (role == Qt::ToolTipRole && index.column() == Speed) {
+        QXmppTransferJob *job = m_jobList[index.row()];
+        if (m_rates.contains(job))
+            return QString(tr("Peak: %1")).arg(formatRate(m_rates.value(job).peak()));
     }
 
     return QVariant();
@@ -129,8 +184,10 @@ QVariant TransferManagerModel::data(const QModelIndex &index, int role) const
 void TransferManagerModel::addJobToList(QXmppTransferJob *job)
 {
     beginInsertRows(QModelIndex(), m_jobList.count(), m_jobList.count());
+    m_rows.insert(job, m_jobList.count());
     m_jobList << job;
-    m_doneSize << 0;
+    m_doneSize.insert(job, 0);
+    m_rates.insert(job, TransferRate());
     connect(job, SIGNAL(finished()),
             this, SLOT(jobFinished()) );
     connect(job, SIGNAL(progress(qint64,qint64)),
@@ -140,13 +197,39 @@ void TransferManagerModel::addJobToList(QXmppTransferJob *job)
     endInsertRows();
 }
 
+void TransferManagerModel::addOutgoingJob(QXmppTransferJob *job, const QString &filePath)
+{
+    addJobToList(job);
+    if (job->fileHash().isEmpty()) {
+        m_checksums.insert(job, ChecksumUnavailable);
+        return;
+    }
+
+    OutgoingHash *hash = new OutgoingHash(filePath);
+    if (hash->isValid()) {
+        m_outgoingHashes.insert(job, hash);
+    } else {
+        // nothing to compare the offer against
+        delete hash;
+        m_checksums.insert(job, ChecksumUnavailable);
+    }
+}
+
+void TransferManagerModel::setChecksumState(QXmppTransferJob *job, ChecksumState state)
+{
+    int row = rowOf(job);
+    if (row == -1)
+        return;
+    m_checksums.insert(job, state);
+    dataChanged(index(row, Checksum), index(row, Checksum));
+}
+
 void TransferManagerModel::removeJobFromList(QXmppTransferJob *job)
 {
-    int row = m_jobList.indexOf(job);
-    beginRemoveRows(QModelIndex(), row, row);
-    m_jobList.removeAt(row);
-    m_doneSize.removeAt(row);
-    endRemoveColumns();
+    int row = rowOf(job);
+    if (row == -1)
+        return;
+    removeRow(row);
 }
 
 void TransferManagerModel::stopJobAtRow(int row)
@@ -160,36 +243,166 @@ void TransferManagerModel::clearJob()
     foreach (QXmppTransferJob *job, m_jobList) {
         if (job->state() != QXmppTransferJob::FinishedState)
             unfinished << job;
+        else
+            forgetJob(job);
     }
     m_jobList = unfinished;
+    rebuildRows();
     reset();
 }
 
 void TransferManagerModel::removeRow(int row, const QModelIndex &parent)
 {
-    if (parent != QModelIndex())
+    if (parent != QModelIndex() || row < 0 || row >= m_jobList.count())
         return;
     beginRemoveRows(QModelIndex(), row, row);
-    m_jobList.removeAt(row);
+    forgetJob(m_jobList.takeAt(row));
+    rebuildRows();
     endRemoveRows();
 }
 
+int TransferManagerModel::rowOf(QObject *job) const
+{
+    return m_rows.value(static_cast<QXmppTransferJob *>(job), -1);
+}
+
+void TransferManagerModel::rebuildRows()
+{
+    m_rows.clear();
+    for (int row = 0; row < m_jobList.count(); row++) {
+        m_rows.insert(m_jobList.at(row), row);
+    }
+    // rows moved, repaint everything pending at once
+    if (m_dirtyFirst != -1) {
+        m_dirtyFirst = 0;
+        m_dirtyLast = m_jobList.count() - 1;
+    }
+}
+
+void TransferManagerModel::forgetJob(QXmppTransferJob *job)
+{
+    disconnect(job, 0, this, 0);
+    m_doneSize.remove(job);
+    m_rates.remove(job);
+    m_checksums.remove(job);
+    delete m_outgoingHashes.take(job);
+}
+
 void TransferManagerModel::jobFinished()
 {
-    int row = m_jobList.indexOf(qobject_cast<QXmppTransferJob *>(sender()));
-    dataChanged(index(row, 0), index(row, 6));
+    QXmppTransferJob *job = static_cast<QXmppTransferJob *>(sender());
+    int row = rowOf(job);
+    if (row == -1)
+        return;
+
+    // the file must still be what the offer advertised when the last byte left
+    OutgoingHash *hash = m_outgoingHashes.take(job);
+    if (hash != 0) {
+        if (job->error() == QXmppTransferJob::NoError)
+            m_checksums.insert(job, hash->result() == job->fileHash() ? ChecksumVerified
+                                                                      : ChecksumMismatch);
+        delete hash;
+    }
+    dataChanged(index(row, 0), index(row, Checksum));
 }
 
 void TransferManagerModel::jobProgress(qint64 done, qint64 /* total */)
 {
-    qDebug() << "progress" << done;
-    int row = m_jobList.indexOf(qobject_cast<QXmppTransferJob *>(sender()));
-    m_doneSize[row] = done;
-    dataChanged(index(row,Progress), index(row, Progress));
+    StallScope stallScope("TransferManagerModel::jobProgress");
+    static qint64 &transferred = Metrics::counter("transfer.bytes");
+    static Histogram &latency = Metrics::histogram("transfer.model.progress");
+    ScopedLatency scope(latency);
+
+    QXmppTransferJob *job = static_cast<QXmppTransferJob *>(sender());
+    int row = rowOf(job);
+    if (row == -1)
+        return;
+
+    qint64 &doneSize = m_doneSize[job];
+    transferred += done - doneSize;
+    doneSize = done;
+    m_rates[job].update(done, m_clock.elapsed());
+    OutgoingHash *hash = m_outgoingHashes.value(job);
+    if (hash != 0)
+        hash->advance(done);
+    if (!m_rateTimer->isActive())
+        m_rateTimer->start();
+
+    m_dirtyFirst = m_dirtyFirst == -1 ? row : qMin(m_dirtyFirst, row);
+    m_dirtyLast = qMax(m_dirtyLast, row);
+    if (!m_repaintTimer->isActive())
+        m_repaintTimer->start();
+}
+
+void TransferManagerModel::repaintProgress()
+{
+    static Histogram &latency = Metrics::histogram("transfer.model.repaint");
+    ScopedLatency scope(latency);
+
+    if (m_dirtyFirst == -1)
+        return;
+
+    int first = m_dirtyFirst;
+    int last = qMin(m_dirtyLast, m_jobList.count() - 1);
+    m_dirtyFirst = m_dirtyLast = -1;
+    if (first <= last)
+        dataChanged(index(first, Progress), index(last, Progress));
+}
+
+void TransferManagerModel::updateRates()
+{
+    qint64 now = m_clock.elapsed();
+    qint64 totalRate = 0;
+    qint64 socksRate = 0;
+    qint64 ibbRate = 0;
+    qint64 active = 0;
+    foreach (QXmppTransferJob *job, m_jobList) {
+        if (job->state() != QXmppTransferJob::TransferState)
+            continue;
+
+        // without progress the same count is fed again and the rate decays
+        TransferRate &rate = m_rates[job];
+        rate.update(m_doneSize.value(job), now);
+        active++;
+        totalRate += rate.rate();
+        if (job->method() == QXmppTransferJob::SocksMethod)
+            socksRate += rate.rate();
+        else if (job->method() == QXmppTransferJob::InBandMethod)
+            ibbRate += rate.rate();
+    }
+    m_rateGauge.set(totalRate);
+    m_socksRateGauge.set(socksRate);
+    m_ibbRateGauge.set(ibbRate);
+    m_activeGauge.set(active);
+
+    if (active == 0)
+        m_rateTimer->stop();
+    if (!m_jobList.isEmpty())
+        dataChanged(index(0, Speed), index(m_jobList.count() - 1, Eta));
+}
+
+QString TransferManagerModel::formatRate(qint64 bytesPerSecond)
+{
+    if (bytesPerSecond >= 1024 * 1024)
+        return QString("%1 MB/s").arg(bytesPerSecond / (1024.0 * 1024.0), 0, 'f', 1);
+    if (bytesPerSecond >= 1024)
+        return QString("%1 KB/s").arg(bytesPerSecond / 1024.0, 0, 'f', 1);
+    return QString("%1 B/s").arg(bytesPerSecond);
+}
+
+QString TransferManagerModel::formatEta(qint64 seconds)
+{
+    if (seconds < 0)
+        return QString("--");
+    return QString("%1:%2:%3").arg(seconds / 3600)
+            .arg(seconds / 60 % 60, 2, 10, QChar('0'))
+            .arg(seconds % 60, 2, 10, QChar('0'));
 }
 
 void TransferManagerModel::jobStateChanged(QXmppTransferJob::State /* state */)
 {
-    int row = m_jobList.indexOf(qobject_cast<QXmppTransferJob *>(sender()));
+    int row = rowOf(sender());
+    if (row == -1)
+        return;
     dataChanged(index(row, State), index(row, State));
 }
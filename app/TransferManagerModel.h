@@ -28,7 +28,15 @@
 #define TRANSFERMANAGERMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
+#include <QElapsedTimer>
 #include <QXmppTransferManager.h>
+#include "TransferRate.h"
+#include "Metrics.h"
+
+class OutgoingHash;
+
+class QTimer;
 
 class TransferManagerModel : public QAbstractTableModel
 {
@@ -42,7 +50,17 @@ public:
         Progress  = 3,
         FileSize  = 4,
         State     = 5,
-        Method    = 6
+        Method    = 6,
+        Speed     = 7,
+        Eta       = 8,
+        Checksum  = 9
+    };
+    enum ChecksumState
+    {
+        ChecksumPending = 0,
+        ChecksumVerified,
+        ChecksumMismatch,
+        ChecksumUnavailable // no hash in the offer
     };
     explicit TransferManagerModel(QObject *parent = 0);
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
@@ -54,6 +72,8 @@ signals:
 
 public slots:
     void addJobToList(QXmppTransferJob *job);
+    void addOutgoingJob(QXmppTransferJob *job, const QString &filePath);
+    void setChecksumState(QXmppTransferJob *job, ChecksumState state);
     void removeJobFromList(QXmppTransferJob *job);
     void stopJobAtRow(int row);
     void clearJob();
@@ -63,11 +83,32 @@ private slots:
     void jobFinished();
     void jobProgress(qint64 done, qint64 total);
     void jobStateChanged(QXmppTransferJob::State state);
+    void repaintProgress();
+    void updateRates();
 
 private:
     //QXmppTransferManager *m_transferManager;
     QList<QXmppTransferJob *> m_jobList;
-    QList<qint64> m_doneSize;
+    QHash<QXmppTransferJob *, int> m_rows; // rebuilt when rows go away
+    QHash<QXmppTransferJob *, qint64> m_doneSize;
+    QHash<QXmppTransferJob *, TransferRate> m_rates;
+    QHash<QXmppTransferJob *, ChecksumState> m_checksums;
+    QHash<QXmppTransferJob *, OutgoingHash *> m_outgoingHashes;
+    QElapsedTimer m_clock;
+    QTimer *m_repaintTimer;
+    QTimer *m_rateTimer; // runs while a job transfers
+    int m_dirtyFirst; // progress rows changed since the last repaint
+    int m_dirtyLast;
+    GaugeShare m_rateGauge;
+    GaugeShare m_socksRateGauge;
+    GaugeShare m_ibbRateGauge;
+    GaugeShare m_activeGauge;
+
+    int rowOf(QObject *job) const;
+    void rebuildRows();
+    void forgetJob(QXmppTransferJob *job);
+    static QString formatRate(qint64 bytesPerSecond);
+    static QString formatEta(qint64 seconds);
 };
 
 #endif // TRANSFERMANAGERMODEL_H
@@ -27,16 +27,21 @@
 #include "TransferManagerWindow.h"
 #include "ui_TransferManagerWindow.h"
 #include "TransferManagerModel.h"
+#include "TransferScheduler.h"
+#include "IncomingFile.h"
+#include "Logger.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QDesktopServices>
 #include <QFile>
 #include <QMenu>
+#include <QStatusBar>
 
 TransferManagerWindow::TransferManagerWindow(QXmppTransferManager *transferManager, QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::TransferManagerWindow),
-    m_transferManager(transferManager)
+    m_transferManager(transferManager),
+    m_scheduler(new TransferScheduler(transferManager, this))
 {
     ui->setupUi(this);
     m_transferManagerModel = new TransferManagerModel(this);
@@ -48,6 +53,13 @@ TransferManagerWindow::TransferManagerWindow(QXmppTransferManager *transferManag
             this, SLOT(stopTransferJob()) );
     connect(ui->actionCleanList, SIGNAL(triggered()),
             m_transferManagerModel, SLOT(clearJob()) );
+    connect(ui->actionPauseQueue, SIGNAL(toggled(bool)),
+            this, SLOT(pauseQueue(bool)) );
+
+    connect(m_scheduler, SIGNAL(jobStarted(QXmppTransferJob*,QString)),
+            m_transferManagerModel, SLOT(addOutgoingJob(QXmppTransferJob*,QString)) );
+    connect(m_scheduler, SIGNAL(queueChanged(int)),
+            this, SLOT(queueChanged(int)) );
 
     ui->tableView->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->tableView, SIGNAL(customContextMenuRequested(const QPoint &)),
@@ -62,7 +74,28 @@ TransferManagerWindow::~TransferManagerWindow()
 
 void TransferManagerWindow::createTransferJob(const QString &jid, const QString &fileName)
 {
-    m_transferManagerModel->addJobToList(m_transferManager->sendFile(jid, fileName));
+    m_scheduler->enqueue(jid, fileName);
+}
+
+TransferScheduler *TransferManagerWindow::scheduler() const
+{
+    return m_scheduler;
+}
+
+void TransferManagerWindow::pauseQueue(bool paused)
+{
+    m_scheduler->setPaused(paused);
+    queueChanged(m_scheduler->queuedCount());
+}
+
+void TransferManagerWindow::queueChanged(int queued)
+{
+    if (queued == 0 && !m_scheduler->isPaused())
+        statusBar()->clearMessage();
+    else if (m_scheduler->isPaused())
+        statusBar()->showMessage(tr("Queue paused, %1 waiting").arg(queued));
+    else
+        statusBar()->showMessage(tr("%1 waiting").arg(queued));
 }
 
 void TransferManagerWindow::receivedTransferJob(QXmppTransferJob *offer)
@@ -76,10 +109,16 @@ void TransferManagerWindow::receivedTransferJob(QXmppTransferJob *offer)
         QString saveFileName =
                 QFileDialog::getSaveFileName(this,
                                              tr("Save File"),
-                                             QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + offer->fileName());
-        QFile *file = new QFile(saveFileName);
-        if (file->open(QIODevice::WriteOnly)) {
+                                             QDesktopServices::storageLocation(QDesktopServices::DesktopLocation) + "/" + offer->fileName());
+        if (saveFileName.isEmpty()) {
+            offer->abort();
+            return;
+        }
+
+        IncomingFile *file = new IncomingFile(saveFileName);
+        if (file->open(offer->fileSize(), offer->fileHash())) {
             offer->accept(file);
+            file->setSource(offer);
             m_files[offer->sid()] = file;
             show();
             raise();
@@ -99,8 +138,20 @@ void TransferManagerWindow::receivedTransferJob(QXmppTransferJob *offer)
 void TransferManagerWindow::deleteFileHandel(QXmppTransferJob *job)
 {
     if (m_files.contains(job->sid())) {
-        qDebug("delete file handel");
-        delete m_files.take(job->sid());
+        LOG_DEBUG("delete file handel");
+        IncomingFile *file = m_files.take(job->sid());
+        bool completed = job->error() == QXmppTransferJob::NoError;
+        if (!file->finish(completed))
+            statusBar()->showMessage(QString("%1: %2").arg(job->fileName()).arg(file->errorString()));
+        if (completed) {
+            if (!file->hasChecksum())
+                m_transferManagerModel->setChecksumState(job, TransferManagerModel::ChecksumUnavailable);
+            else if (file->checksumMatched())
+                m_transferManagerModel->setChecksumState(job, TransferManagerModel::ChecksumVerified);
+            else
+                m_transferManagerModel->setChecksumState(job, TransferManagerModel::ChecksumMismatch);
+        }
+        delete file;
     }
 }
 
@@ -119,6 +170,7 @@ void TransferManagerWindow::showCustomContextMenu(const QPoint &position)
         actions << ui->actionStopTransfer;
         actions << ui->actionCleanList;
     }
+    actions << ui->actionPauseQueue;
     if (!actions.isEmpty())
         QMenu::exec(actions, ui->tableView->mapToGlobal(position));
 }
@@ -31,7 +31,8 @@
 #include <QXmppTransferManager.h>
 
 class TransferManagerModel;
-class QFile;
+class TransferScheduler;
+class IncomingFile;
 
 namespace Ui {
     class TransferManagerWindow;
@@ -44,6 +45,7 @@ public:
     ~TransferManagerWindow();
     void createTransferJob(const QString &jid, const QString &fileName);
     void receivedTransferJob(QXmppTransferJob *job);
+    TransferScheduler *scheduler() const;
 
 public slots:
     void deleteFileHandel(QXmppTransferJob *job);
@@ -51,6 +53,8 @@ public slots:
 private slots:
     void stopTransferJob();
     void showCustomContextMenu(const QPoint &position);
+    void pauseQueue(bool paused);
+    void queueChanged(int queued);
 
 protected:
     void changeEvent(QEvent *e);
@@ -59,7 +63,8 @@ private:
     Ui::TransferManagerWindow *ui;
     QXmppTransferManager *m_transferManager;
     TransferManagerModel *m_transferManagerModel;
-    QMap<QString, QFile *> m_files;
+    TransferScheduler *m_scheduler;
+    QMap<QString, IncomingFile *> m_files;
 };
 
 #endif // TRANSFERMANAGERWINDOW_H
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TransferRate.h"
+#include <math.h>
+
+static const qint64 MinSampleMsecs = 250;
+static const double TimeConstantMsecs = 3000.0;
+
+TransferRate::TransferRate() :
+    m_sampleDone(0),
+    m_sampleTime(0),
+    m_rate(0.0),
+    m_peak(0.0),
+    m_started(false)
+{
+}
+
+void TransferRate::update(qint64 done, qint64 msecs)
+{
+    if (!m_started) {
+        m_sampleDone = done;
+        m_sampleTime = msecs;
+        m_started = true;
+        return;
+    }
+
+    qint64 elapsed = msecs - m_sampleTime;
+    if (elapsed < MinSampleMsecs)
+        return;
+
+    double sample = (done - m_sampleDone) * 1000.0 / elapsed;
+    // the weight follows the sample length, irregular progress signals
+    // do not skew the average
+    double alpha = 1.0 - exp(-elapsed / TimeConstantMsecs);
+    m_rate += alpha * (sample - m_rate);
+    m_peak = qMax(m_peak, sample);
+
+    m_sampleDone = done;
+    m_sampleTime = msecs;
+}
+
+qint64 TransferRate::rate() const
+{
+    return qint64(m_rate);
+}
+
+qint64 TransferRate::peak() const
+{
+    return qint64(m_peak);
+}
+
+qint64 TransferRate::eta(qint64 remaining) const
+{
+    if (m_rate < 1.0)
+        return -1;
+    return qint64(remaining / m_rate + 0.5);
+}
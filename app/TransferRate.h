@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRANSFERRATE_H
+#define TRANSFERRATE_H
+
+#include <QtGlobal>
+
+// Throughput of one transfer: an exponentially weighted moving average
+// over samples of at least a quarter second, the peak sample and an ETA.
+// Feed it the byte count with a monotonic clock; feeding the same count
+// again lets the rate decay while a transfer stalls.
+class TransferRate
+{
+public:
+    TransferRate();
+    void update(qint64 done, qint64 msecs);
+    qint64 rate() const; // bytes per second
+    qint64 peak() const;
+    qint64 eta(qint64 remaining) const; // seconds, -1 when unknown
+
+private:
+    qint64 m_sampleDone;
+    qint64 m_sampleTime;
+    double m_rate;
+    double m_peak;
+    bool m_started;
+};
+
+#endif // TRANSFERRATE_H
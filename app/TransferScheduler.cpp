@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TransferScheduler.h"
+#include <QXmppUtils.h>
+#include <QTimer>
+
+TokenBucket::TokenBucket(qint64 rate, qint64 burst) :
+    m_rate(rate),
+    m_burst(burst),
+    m_tokens(burst),
+    m_lastRefill(0)
+{
+}
+
+void TokenBucket::setRate(qint64 rate, qint64 burst)
+{
+    m_rate = rate;
+    m_burst = burst;
+    m_tokens = qMin(m_tokens, double(burst));
+}
+
+bool TokenBucket::isLimited() const
+{
+    return m_rate > 0;
+}
+
+void TokenBucket::refill(qint64 msecs)
+{
+    if (m_rate > 0)
+        m_tokens = qMin(double(m_burst), m_tokens + (msecs - m_lastRefill) * m_rate / 1000.0);
+    m_lastRefill = msecs;
+}
+
+void TokenBucket::consume(qint64 bytes)
+{
+    if (m_rate > 0)
+        m_tokens -= bytes;
+}
+
+bool TokenBucket::hasTokens() const
+{
+    return m_rate <= 0 || m_tokens > 0;
+}
+
+qint64 TokenBucket::msecsUntilTokens() const
+{
+    if (hasTokens())
+        return 0;
+    return qint64(-m_tokens * 1000.0 / m_rate) + 1;
+}
+
+// at most one second of traffic up front
+static qint64 burstFor(qint64 rate)
+{
+    return rate;
+}
+
+TransferScheduler::TransferScheduler(QXmppTransferManager *transferManager, QObject *parent) :
+    QObject(parent),
+    m_transferManager(transferManager),
+    m_peerRate(0),
+    m_maxActive(2),
+    m_paused(false),
+    m_retryTimer(new QTimer(this)),
+    m_queuedGauge("transfer.queued")
+{
+    m_clock.start();
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, SIGNAL(timeout()),
+            this, SLOT(startNext()) );
+}
+
+void TransferScheduler::setMaxActive(int maxActive)
+{
+    m_maxActive = qMax(1, maxActive);
+    startNext();
+}
+
+int TransferScheduler::maxActive() const
+{
+    return m_maxActive;
+}
+
+void TransferScheduler::setGlobalAdmissionRate(qint64 bytesPerSecond)
+{
+    m_globalBucket.setRate(bytesPerSecond, burstFor(bytesPerSecond));
+    startNext();
+}
+
+void TransferScheduler::setPeerAdmissionRate(qint64 bytesPerSecond)
+{
+    m_peerRate = bytesPerSecond;
+    QHash<QString, TokenBucket>::iterator it;
+    for (it = m_peerBuckets.begin(); it != m_peerBuckets.end(); ++it) {
+        it.value().setRate(bytesPerSecond, burstFor(bytesPerSecond));
+    }
+    startNext();
+}
+
+void TransferScheduler::enqueue(const QString &jid, const QString &fileName)
+{
+    Pending pending;
+    pending.jid = jid;
+    pending.fileName = fileName;
+    m_queue.enqueue(pending);
+    m_queuedGauge.set(m_queue.count());
+    emit queueChanged(m_queue.count());
+    startNext();
+}
+
+void TransferScheduler::setPaused(bool paused)
+{
+    m_paused = paused;
+    if (!m_paused)
+        startNext();
+}
+
+bool TransferScheduler::isPaused() const
+{
+    return m_paused;
+}
+
+int TransferScheduler::queuedCount() const
+{
+    return m_queue.count();
+}
+
+int TransferScheduler::activeCount() const
+{
+    return m_active.count();
+}
+
+TokenBucket &TransferScheduler::peerBucket(const QString &jid)
+{
+    QString bareJid = jidToBareJid(jid);
+    if (!m_peerBuckets.contains(bareJid))
+        m_peerBuckets.insert(bareJid, TokenBucket(m_peerRate, burstFor(m_peerRate)));
+    return m_peerBuckets[bareJid];
+}
+
+void TransferScheduler::startNext()
+{
+    if (m_paused)
+        return;
+
+    qint64 now = m_clock.elapsed();
+    m_globalBucket.refill(now);
+    qint64 wait = m_globalBucket.msecsUntilTokens();
+
+    // first come first served, but a peer in debt does not hold up the others
+    for (int i = 0; i < m_queue.count() && m_active.count() < m_maxActive && wait == 0; ) {
+        TokenBucket &bucket = peerBucket(m_queue.at(i).jid);
+        bucket.refill(now);
+        if (!bucket.hasTokens()) {
+            i++;
+            continue;
+        }
+
+        Pending pending = m_queue.takeAt(i);
+        QXmppTransferJob *job = m_transferManager->sendFile(pending.jid, pending.fileName);
+        m_active.insert(job, 0);
+        connect(job, SIGNAL(progress(qint64,qint64)),
+                this, SLOT(jobProgress(qint64,qint64)) );
+        connect(job, SIGNAL(finished()),
+                this, SLOT(jobFinished()) );
+        emit jobStarted(job, pending.fileName);
+        m_queuedGauge.set(m_queue.count());
+        emit queueChanged(m_queue.count());
+    }
+
+    // come back when the first bucket blocking the queue has refilled
+    if (m_queue.isEmpty() || m_active.count() >= m_maxActive)
+        return;
+    if (wait == 0) {
+        foreach (const Pending &pending, m_queue) {
+            qint64 peerWait = peerBucket(pending.jid).msecsUntilTokens();
+            wait = wait == 0 ? peerWait : qMin(wait, peerWait);
+        }
+    }
+    if (wait > 0 && !m_retryTimer->isActive())
+        m_retryTimer->start(int(qMin(wait, Q_INT64_C(60000))));
+}
+
+void TransferScheduler::jobProgress(qint64 done, qint64 /* total */)
+{
+    QXmppTransferJob *job = static_cast<QXmppTransferJob *>(sender());
+    QHash<QXmppTransferJob *, qint64>::iterator it = m_active.find(job);
+    if (it == m_active.end())
+        return;
+
+    qint64 now = m_clock.elapsed();
+    qint64 bytes = done - it.value();
+    it.value() = done;
+
+    m_globalBucket.refill(now);
+    m_globalBucket.consume(bytes);
+    TokenBucket &bucket = peerBucket(job->jid());
+    bucket.refill(now);
+    bucket.consume(bytes);
+}
+
+void TransferScheduler::jobFinished()
+{
+    QXmppTransferJob *job = static_cast<QXmppTransferJob *>(sender());
+    if (m_active.remove(job) == 0)
+        return;
+    disconnect(job, 0, this, 0);
+    startNext();
+}
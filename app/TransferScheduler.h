@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRANSFERSCHEDULER_H
+#define TRANSFERSCHEDULER_H
+
+#include <QObject>
+#include <QQueue>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QXmppTransferManager.h>
+#include "Metrics.h"
+
+class QTimer;
+
+// Bytes per second with a burst allowance. Tokens may go negative, the
+// debt is paid back before anything new is admitted.
+class TokenBucket
+{
+public:
+    TokenBucket(qint64 rate = 0, qint64 burst = 0);
+    void setRate(qint64 rate, qint64 burst);
+    bool isLimited() const;
+    void refill(qint64 msecs);
+    void consume(qint64 bytes);
+    bool hasTokens() const;
+    qint64 msecsUntilTokens() const;
+
+private:
+    qint64 m_rate;
+    qint64 m_burst;
+    double m_tokens;
+    qint64 m_lastRefill;
+};
+
+// Outgoing files wait here until there is a free slot and bandwidth.
+// QXmppTransferManager streams a started job at its own pace, so the rates
+// only control admission: bytes reported by running jobs drain the global
+// and the per peer bucket, and no new job starts for a peer while either is
+// in debt. A running job is never slowed down, a single large file goes as
+// fast as the link allows.
+class TransferScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TransferScheduler(QXmppTransferManager *transferManager, QObject *parent = 0);
+
+    void setMaxActive(int maxActive);
+    int maxActive() const;
+    void setGlobalAdmissionRate(qint64 bytesPerSecond); // 0 is unlimited
+    void setPeerAdmissionRate(qint64 bytesPerSecond);
+
+    void enqueue(const QString &jid, const QString &fileName);
+    void setPaused(bool paused); // running jobs continue, nothing new starts
+    bool isPaused() const;
+    int queuedCount() const;
+    int activeCount() const;
+
+signals:
+    void jobStarted(QXmppTransferJob *job, const QString &filePath);
+    void queueChanged(int queued);
+
+private slots:
+    void startNext();
+    void jobProgress(qint64 done, qint64 total);
+    void jobFinished();
+
+private:
+    struct Pending
+    {
+        QString jid;
+        QString fileName;
+    };
+
+    QXmppTransferManager *m_transferManager;
+    QQueue<Pending> m_queue;
+    QHash<QXmppTransferJob *, qint64> m_active; // job -> bytes seen
+    QElapsedTimer m_clock;
+    TokenBucket m_globalBucket;
+    QHash<QString, TokenBucket> m_peerBuckets;
+    qint64 m_peerRate;
+    int m_maxActive;
+    bool m_paused;
+    QTimer *m_retryTimer;
+    GaugeShare m_queuedGauge;
+
+    TokenBucket &peerBucket(const QString &jid);
+};
+
+#endif // TRANSFERSCHEDULER_H
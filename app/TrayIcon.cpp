@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TrayIcon.h"
+#include "MainWindow.h"
+#include "IconCache.h"
+#include <QApplication>
+#include <QMenu>
+
+TrayIcon *TrayIcon::instance()
+{
+    static TrayIcon *trayIcon = 0;
+    if (trayIcon == 0)
+        trayIcon = new TrayIcon;
+    return trayIcon;
+}
+
+TrayIcon::TrayIcon(QObject *parent) :
+    QObject(parent),
+    m_trayIcon(new QSystemTrayIcon(this)),
+    m_menu(new QMenu),
+    m_quitAction(new QAction(tr("Quit"), this))
+{
+    m_trayIcon->setIcon(IconCache::icon(":/images/im-user-offline.png"));
+    m_trayIcon->setContextMenu(m_menu);
+
+    connect(m_trayIcon, SIGNAL(activated(QSystemTrayIcon::ActivationReason)),
+            this, SLOT(activated(QSystemTrayIcon::ActivationReason)) );
+    // every window saves its preferences on aboutToQuit
+    connect(m_quitAction, SIGNAL(triggered()),
+            qApp, SLOT(quit()) );
+}
+
+void TrayIcon::addWindow(MainWindow *window, QMenu *menu)
+{
+    if (m_windowMenus.contains(window))
+        return;
+    m_windows << window;
+    m_windowMenus.insert(window, menu);
+    m_states.insert(window, Offline);
+    rebuildMenu();
+    updateIcon();
+    m_trayIcon->show();
+}
+
+void TrayIcon::removeWindow(MainWindow *window)
+{
+    if (!m_windowMenus.contains(window))
+        return;
+    m_windows.removeAll(window);
+    m_windowMenus.remove(window);
+    m_states.remove(window);
+    rebuildMenu();
+    updateIcon();
+    if (m_windows.isEmpty())
+        m_trayIcon->hide();
+}
+
+void TrayIcon::setState(MainWindow *window, State state)
+{
+    if (!m_states.contains(window) || m_states.value(window) == state)
+        return;
+    m_states.insert(window, state);
+    updateIcon();
+}
+
+void TrayIcon::showMessage(const QString &title, const QString &message)
+{
+    m_trayIcon->showMessage(title, message);
+}
+
+QRect TrayIcon::geometry() const
+{
+    return m_trayIcon->geometry();
+}
+
+void TrayIcon::rebuildMenu()
+{
+    m_menu->clear();
+
+    // a single account keeps the flat menu, several get one submenu each
+    if (m_windows.count() == 1) {
+        m_menu->addActions(m_windowMenus.value(m_windows.first())->actions());
+    } else {
+        foreach (MainWindow *window, m_windows) {
+            m_menu->addMenu(m_windowMenus.value(window));
+        }
+    }
+
+    m_menu->addSeparator();
+    m_menu->addAction(m_quitAction);
+}
+
+void TrayIcon::updateIcon()
+{
+    State state = Offline;
+    foreach (State windowState, m_states) {
+        state = qMax(state, windowState);
+    }
+
+    switch (state) {
+    case Unread:
+        m_trayIcon->setIcon(IconCache::icon(":/images/mail-unread-new.png"));
+        break;
+    case InfoEvent:
+        m_trayIcon->setIcon(IconCache::icon(":/images/ktip.png"));
+        break;
+    case Busy:
+        m_trayIcon->setIcon(IconCache::icon(":/images/im-user-busy.png"));
+        break;
+    case Away:
+        m_trayIcon->setIcon(IconCache::icon(":/images/im-user-away.png"));
+        break;
+    case Online:
+        m_trayIcon->setIcon(IconCache::icon(":/images/im-user.png"));
+        break;
+    default:
+        m_trayIcon->setIcon(IconCache::icon(":/images/im-user-offline.png"));
+        break;
+    }
+}
+
+void TrayIcon::activated(QSystemTrayIcon::ActivationReason reason)
+{
+    if (reason != QSystemTrayIcon::Trigger || m_windows.isEmpty())
+        return;
+
+    // unread messages first, from the account that has them
+    foreach (MainWindow *window, m_windows) {
+        if (m_states.value(window) == Unread) {
+            window->trayIconActivated();
+            return;
+        }
+    }
+
+    // otherwise the account windows are shown or hidden together
+    bool anyHidden = false;
+    foreach (MainWindow *window, m_windows) {
+        anyHidden = anyHidden || !window->isVisible();
+    }
+    foreach (MainWindow *window, m_windows) {
+        if (anyHidden) {
+            window->show();
+            window->raise();
+            window->activateWindow();
+        } else {
+            window->hide();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRAYICON_H
+#define TRAYICON_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QSystemTrayIcon>
+
+class MainWindow;
+class QAction;
+class QMenu;
+
+// The one tray icon of the process, shared by every account window. Each
+// window adds its own menu and reports its state; the icon shows the most
+// urgent state of all of them.
+class TrayIcon : public QObject
+{
+    Q_OBJECT
+public:
+    // in order of urgency
+    enum State
+    {
+        Offline,
+        Online,
+        Away,
+        Busy,
+        InfoEvent,
+        Unread
+    };
+
+    static TrayIcon *instance();
+
+    void addWindow(MainWindow *window, QMenu *menu);
+    void removeWindow(MainWindow *window);
+    void setState(MainWindow *window, State state);
+    void showMessage(const QString &title, const QString &message);
+    QRect geometry() const;
+
+private slots:
+    void activated(QSystemTrayIcon::ActivationReason reason);
+
+private:
+    explicit TrayIcon(QObject *parent = 0);
+
+    QSystemTrayIcon *m_trayIcon;
+    QMenu *m_menu;
+    QAction *m_quitAction;
+    QList<MainWindow *> m_windows; // in the order they were added
+    QMap<MainWindow *, QMenu *> m_windowMenus;
+    QMap<MainWindow *, State> m_states;
+
+    void rebuildMenu();
+    void updateIcon();
+};
+
+#endif // TRAYICON_H
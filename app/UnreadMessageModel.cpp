@@ -25,19 +25,31 @@
  */
 
 #include "UnreadMessageModel.h"
+#include "Logger.h"
 #include "QXmppUtils.h"
 
 UnreadMessageModel::UnreadMessageModel(QObject *parent)
-    : QAbstractListModel(parent)
+    : QAbstractListModel(parent),
+    m_depth("unread.messages")
 {
 }
 
 void UnreadMessageModel::add(const QXmppMessage &message)
 {
     m_messageStore[jidToBareJid(message.from())] << message;
+    updateDepth();
     reset();
 }
 
+void UnreadMessageModel::updateDepth()
+{
+    qint64 depth = 0;
+    foreach (const QList<QXmppMessage> &messages, m_messageStore) {
+        depth += messages.count();
+    }
+    m_depth.set(depth);
+}
+
 QList<QXmppMessage> UnreadMessageModel::take(QString jid)
 {
     QString resource = jidToResource(jid);
@@ -59,8 +71,9 @@ QList<QXmppMessage> UnreadMessageModel::take(QString jid)
     if (m_messageStore.isEmpty()) {
         emit messageCleared();
     } else {
-        qDebug("no empty");
+        LOG_DEBUG("no empty");
     }
+    updateDepth();
     reset();
     return results;
 }
@@ -33,6 +33,7 @@
 #include "QXmppMessage.h"
 #include <QModelIndex>
 #include <QVariant>
+#include "Metrics.h"
 
 class UnreadMessageModel : public QAbstractListModel
 {
@@ -54,6 +55,8 @@ signals:
     void messageCleared();
 
 private:
+    void updateDepth();
     QMap<QString, QList<QXmppMessage> > m_messageStore;
+    GaugeShare m_depth;
 };
 #endif
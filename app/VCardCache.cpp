@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "VCardCache.h"
+#include "Metrics.h"
+#include <QImage>
+#include <QPixmap>
+
+VCardCache *VCardCache::instance()
+{
+    static VCardCache *cache = 0;
+    if (cache == 0)
+        cache = new VCardCache;
+    return cache;
+}
+
+VCardCache::VCardCache(QObject *parent) :
+    QObject(parent)
+{
+}
+
+bool VCardCache::contains(const QString &bareJid) const
+{
+    static qint64 &hits = Metrics::counter("vcard.lookup.hit");
+    static qint64 &misses = Metrics::counter("vcard.lookup.miss");
+
+    bool found = m_vCards.contains(bareJid);
+    if (found)
+        hits++;
+    else
+        misses++;
+    return found;
+}
+
+QXmppVCard VCardCache::vCard(const QString &bareJid) const
+{
+    return m_vCards.value(bareJid);
+}
+
+QIcon VCardCache::avatar(const QString &bareJid)
+{
+    static qint64 &hits = Metrics::counter("vcard.avatar.hit");
+    static qint64 &misses = Metrics::counter("vcard.avatar.miss");
+
+    QHash<QString, QIcon>::const_iterator it = m_avatars.constFind(bareJid);
+    if (it != m_avatars.constEnd()) {
+        hits++;
+        return it.value();
+    }
+    misses++;
+
+    QIcon icon;
+    if (m_vCards.contains(bareJid)) {
+        QImage image = m_vCards[bareJid].photoAsImage();
+        if (!image.isNull())
+            icon = QIcon(QPixmap::fromImage(image.scaled(QSize(64, 64))));
+        // remember a missing photo too, it is not decoded again
+        m_avatars.insert(bareJid, icon);
+    }
+    return icon;
+}
+
+void VCardCache::insert(const QXmppVCard &vCard)
+{
+    m_vCards[vCard.from()] = vCard;
+    m_avatars.remove(vCard.from());
+    emit vCardChanged(vCard.from());
+}
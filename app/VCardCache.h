@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef VCARDCACHE_H
+#define VCARDCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QIcon>
+#include <QMap>
+#include <QXmppVCard.h>
+
+// vCards and scaled avatars, shared by every account of the process. A
+// contact known to several accounts is requested and decoded only once.
+class VCardCache : public QObject
+{
+    Q_OBJECT
+public:
+    static VCardCache *instance();
+
+    bool contains(const QString &bareJid) const;
+    QXmppVCard vCard(const QString &bareJid) const; // if no exist, return empty vcard
+    QIcon avatar(const QString &bareJid);           // null icon if no photo
+    void insert(const QXmppVCard &vCard);
+
+signals:
+    void vCardChanged(const QString &bareJid);
+
+private:
+    explicit VCardCache(QObject *parent = 0);
+
+    QMap<QString, QXmppVCard> m_vCards; // <bareJid, vcard>
+    QHash<QString, QIcon> m_avatars;    // <bareJid, scaled photo>
+};
+
+#endif // VCARDCACHE_H
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "XhtmlIm.h"
+#include <QSet>
+#include <QStringList>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextCharFormat>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+static const int MaxInputLength = 256 * 1024;
+static const int MaxOutputLength = 64 * 1024;
+static const int MaxElements = 2000;
+static const int MaxDepth = 32;
+
+static const char *allowedElementNames[] = {
+    "a", "blockquote", "br", "cite", "code", "em", "li", "ol",
+    "p", "pre", "q", "span", "strong", "ul", 0
+};
+
+// elements whose whole content is dropped, not only the tag
+static const char *droppedElementNames[] = {
+    "head", "img", "object", "embed", "iframe", "script", "style", "title", 0
+};
+
+static const char *allowedStyleNames[] = {
+    "background-color", "color", "font-style", "font-weight", "text-decoration", 0
+};
+
+static const char *allowedSchemes[] = {
+    "http", "https", "ftp", "mailto", "xmpp", 0
+};
+
+static QSet<QString> nameSet(const char **names)
+{
+    QSet<QString> set;
+    for (int i = 0; names[i] != 0; i++)
+        set << QString::fromLatin1(names[i]);
+    return set;
+}
+
+static QString sanitizeStyle(const QString &style)
+{
+    static const QSet<QString> allowedStyles = nameSet(allowedStyleNames);
+
+    QStringList result;
+    foreach (QString declaration, style.split(';', QString::SkipEmptyParts)) {
+        int pos = declaration.indexOf(':');
+        if (pos < 0)
+            continue;
+        QString name = declaration.left(pos).trimmed().toLower();
+        QString value = declaration.mid(pos + 1).trimmed();
+        if (!allowedStyles.contains(name) || value.isEmpty())
+            continue;
+        if (value.contains('(') || value.contains('\\') || value.length() > 64)
+            continue;
+        result << name + ":" + value;
+    }
+    return result.join(";");
+}
+
+static bool isAllowedHref(const QString &href)
+{
+    static const QSet<QString> schemes = nameSet(allowedSchemes);
+
+    int pos = href.indexOf(':');
+    if (pos <= 0)
+        return false;
+    return schemes.contains(href.left(pos).trimmed().toLower());
+}
+
+static QString styleFor(const QTextCharFormat &format, const QTextCharFormat &base)
+{
+    QStringList style;
+    if (format.fontWeight() > QFont::Normal)
+        style << "font-weight:bold";
+    if (format.fontItalic())
+        style << "font-style:italic";
+    if (format.fontUnderline())
+        style << "text-decoration:underline";
+    else if (format.fontStrikeOut())
+        style << "text-decoration:line-through";
+    if (format.foreground().style() != Qt::NoBrush
+        && format.foreground() != base.foreground())
+        style << "color:" + format.foreground().color().name();
+    if (format.background().style() != Qt::NoBrush
+        && format.background() != base.background())
+        style << "background-color:" + format.background().color().name();
+    return style.join(";");
+}
+
+static QString escapeText(const QString &text)
+{
+    QString result;
+    result.reserve(text.length());
+    for (int i = 0; i < text.length(); i++) {
+        const QChar c = text.at(i);
+        switch (c.unicode()) {
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        case '&':
+            result += "&amp;";
+            break;
+        case '"':
+            result += "&quot;";
+            break;
+        case 0x2028: // QChar::LineSeparator, shift + enter in the editor
+            result += "<br/>";
+            break;
+        case 0xfffc: // QChar::ObjectReplacementCharacter, inline images are not sent
+            break;
+        default:
+            result += c;
+            break;
+        }
+    }
+    return result;
+}
+
+QString XhtmlIm::encode(const QTextDocument *document, bool *hasFormatting)
+{
+    const QTextCharFormat base = document->begin().charFormat();
+    QString body;
+    bool formatted = false;
+
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        if (block != document->begin())
+            body += "<br/>";
+
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            QTextFragment fragment = it.fragment();
+            if (!fragment.isValid())
+                continue;
+
+            QTextCharFormat format = fragment.charFormat();
+            QString text = escapeText(fragment.text());
+            QString style = styleFor(format, base);
+            QString href = format.isAnchor() ? format.anchorHref() : QString();
+            if (!href.isEmpty() && isAllowedHref(href)) {
+                text = QString("<a href=\"%1\">%2</a>").arg(escapeText(href), text);
+                formatted = true;
+            }
+            if (!style.isEmpty()) {
+                text = QString("<span style=\"%1\">%2</span>").arg(style, text);
+                formatted = true;
+            }
+            body += text;
+        }
+    }
+
+    if (hasFormatting)
+        *hasFormatting = formatted;
+    return body;
+}
+
+QString XhtmlIm::wrap(const QString &body)
+{
+    return QString("<html xmlns=\"http://jabber.org/protocol/xhtml-im\">"
+                   "<body xmlns=\"http://www.w3.org/1999/xhtml\">%1</body></html>").arg(body);
+}
+
+QString XhtmlIm::sanitize(const QString &xml)
+{
+    static const QSet<QString> allowedElements = nameSet(allowedElementNames);
+    static const QSet<QString> droppedElements = nameSet(droppedElementNames);
+
+    if (xml.length() > MaxInputLength)
+        return QString();
+
+    QString output;
+    QXmlStreamReader reader(xml);
+    QXmlStreamWriter writer(&output);
+
+    QVector<bool> written; // per open element inside <body/>, was the tag copied
+    bool inBody = false;
+    bool bodyDone = false;
+    int skipDepth = 0;
+    int elements = 0;
+
+    while (!reader.atEnd() && !bodyDone) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement: {
+            const QString name = reader.name().toString();
+            if (!inBody) {
+                if (name == "body")
+                    inBody = true;
+                break;
+            }
+
+            if (++elements > MaxElements)
+                return QString();
+
+            if (skipDepth > 0 || droppedElements.contains(name)) {
+                skipDepth++;
+                break;
+            }
+
+            if (written.count() >= MaxDepth)
+                return QString();
+
+            bool keep = allowedElements.contains(name);
+            written.append(keep);
+            if (!keep)
+                break;
+
+            writer.writeStartElement(name);
+            QXmlStreamAttributes attributes = reader.attributes();
+            QString style = sanitizeStyle(attributes.value("style").toString());
+            if (!style.isEmpty())
+                writer.writeAttribute("style", style);
+            if (name == "a") {
+                QString href = attributes.value("href").toString();
+                if (isAllowedHref(href))
+                    writer.writeAttribute("href", href);
+            }
+            break;
+        }
+        case QXmlStreamReader::EndElement:
+            if (!inBody)
+                break;
+            if (skipDepth > 0) {
+                skipDepth--;
+            } else if (written.isEmpty()) {
+                // end of <body/>, ignore anything after it
+                bodyDone = true;
+            } else {
+                if (written.last())
+                    writer.writeEndElement();
+                written.pop_back();
+            }
+            break;
+        case QXmlStreamReader::Characters:
+            if (inBody && skipDepth == 0)
+                writer.writeCharacters(reader.text().toString());
+            break;
+        default:
+            break;
+        }
+
+        if (output.length() > MaxOutputLength)
+            return QString();
+    }
+
+    if (reader.hasError() && !bodyDone)
+        return QString();
+
+    return output;
+}
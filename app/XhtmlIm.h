@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef XHTMLIM_H
+#define XHTMLIM_H
+
+#include <QString>
+
+class QTextDocument;
+
+// XHTML-IM (XEP-0071) helpers for chat messages.
+class XhtmlIm
+{
+public:
+    // Reduce a serialised <html/> payload to the children of its <body/>,
+    // keeping only whitelisted elements, attributes and style properties.
+    // Returns an empty string if the payload is malformed or too heavy, the
+    // caller should then fall back to the plain body.
+    static QString sanitize(const QString &xml);
+
+    // Walk the document once and return the children of an XHTML-IM <body/>.
+    // hasFormatting is set to false when the text carries no formatting at
+    // all, the XHTML-IM part can then be left out of the message.
+    static QString encode(const QTextDocument *document, bool *hasFormatting = 0);
+
+    // Wrap the children of a <body/> into the <html/> extension element.
+    static QString wrap(const QString &body);
+};
+
+#endif // XHTMLIM_H
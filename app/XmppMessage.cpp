@@ -27,15 +27,18 @@
 #include "XmppMessage.h"
 #include <QDomDocument>
 #include <QXmlStreamWriter>
+#include "XhtmlIm.h"
 
 XmppMessage::XmppMessage(const QString& from, const QString& to, const 
                          QString& body, const QString& thread)
-    : QXmppMessage(from, to, body, thread)
+    : QXmppMessage(from, to, body, thread),
+      m_htmlParsed(false)
 {
 }
 
 XmppMessage::XmppMessage(const QXmppMessage &other)
-    : QXmppMessage(other)
+    : QXmppMessage(other),
+      m_htmlParsed(false)
 {
 }
 
@@ -47,17 +50,24 @@ void XmppMessage::setHtml(const QString &html)
     QXmppElementList elementList = extensions();
     elementList << element;
     setExtensions(elementList);
+    m_htmlParsed = false;
 }
 
 QString XmppMessage::html() const
 {
+    if (m_htmlParsed)
+        return m_html;
+
+    m_htmlParsed = true;
+    m_html.clear();
     foreach (QXmppElement element, extensions()) {
         if (element.tagName() == "html") {
-            QString html;
-            QXmlStreamWriter writer(&html);
+            QString xml;
+            QXmlStreamWriter writer(&xml);
             element.toXml(&writer);
-            return html;
+            m_html = XhtmlIm::sanitize(xml);
+            break;
         }
     }
-    return "";
+    return m_html;
 }
@@ -36,6 +36,10 @@ public:
                 const QString& body = "", const QString& thread = "");
     XmppMessage(const QXmppMessage &other);
     void setHtml(const QString &html);
-    QString html() const;
+    QString html() const; // sanitised XHTML-IM body, parsed once per message
+
+private:
+    mutable QString m_html;
+    mutable bool m_htmlParsed;
 };
 #endif
@@ -20,9 +20,13 @@ CONFIG(debug, debug|release) {
     QXMPP_LIB = QXmppClient
     QXMPP_DIR = ../lib/QXmppClient/source/release
     TARGET = qtalk
+    # compile out debug log statements
+    DEFINES += QTALK_LOG_LEVEL=1
 }
 
 LIBS += -L$$QXMPP_DIR -l$$QXMPP_LIB
+# symbol names in the stall watchdog backtraces
+linux-*:QMAKE_LFLAGS += -rdynamic
 PRE_TARGETDEPS += $${QXMPP_DIR}/lib$${QXMPP_LIB}.a
 
 # Input
@@ -32,10 +36,26 @@ RESOURCES = application.qrc
 TRANSLATIONS = translations/qtalk_zh_CN.ts
 
 SOURCES += main.cpp \
+           HeadlessClient.cpp \
+           Outbox.cpp \
+           ReconnectScheduler.cpp \
            MainWindow.cpp \
            ChatWindow.cpp \
+           MessageModel.cpp \
+           MessageDelegate.cpp \
            XmppMessage.cpp \
+           XhtmlIm.cpp \
            RosterModel.cpp \
+           VCardCache.cpp \
+           IconCache.cpp \
+           TrayIcon.cpp \
+           StartupTrace.cpp \
+           Logger.cpp \
+           RotatingFile.cpp \
+           Metrics.cpp \
+           MetricsServer.cpp \
+           DiagnosticsWindow.cpp \
+           StallWatchdog.cpp \
            UnreadMessageWindow.cpp \
            UnreadMessageModel.cpp \
            LoginWidget.cpp \
@@ -50,13 +70,36 @@ SOURCES += main.cpp \
            ContactInfoDialog.cpp \
            TransferManagerWindow.cpp \
            TransferManagerModel.cpp \
+           TransferRate.cpp \
+           TransferScheduler.cpp \
+           IncomingFile.cpp \
+           OutgoingHash.cpp \
+           ProxySelector.cpp \
+           CapsCache.cpp \
+           CapsTracker.cpp \
            AddContactDialog.cpp \
            InfoEventStackWidget.cpp \
            InfoEventSubscribeRequest.cpp
 HEADERS += MainWindow.h \
+           HeadlessClient.h \
+           Outbox.h \
+           ReconnectScheduler.h \
            ChatWindow.h \
+           MessageModel.h \
+           MessageDelegate.h \
            XmppMessage.h \
+           XhtmlIm.h \
            RosterModel.h  \
+           VCardCache.h \
+           IconCache.h \
+           TrayIcon.h \
+           StartupTrace.h \
+           Logger.h \
+           RotatingFile.h \
+           Metrics.h \
+           MetricsServer.h \
+           DiagnosticsWindow.h \
+           StallWatchdog.h \
            UnreadMessageWindow.h \
            UnreadMessageModel.h \
            LoginWidget.h \
@@ -71,6 +114,13 @@ HEADERS += MainWindow.h \
            ContactInfoDialog.h \
            TransferManagerWindow.h \
            TransferManagerModel.h \
+           TransferRate.h \
+           TransferScheduler.h \
+           IncomingFile.h \
+           OutgoingHash.h \
+           ProxySelector.h \
+           CapsCache.h \
+           CapsTracker.h \
            AddContactDialog.h \
            InfoEventStackWidget.h \
            InfoEventSubscribeRequest.h
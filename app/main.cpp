@@ -26,19 +26,103 @@
 
 #include <QApplication>
 #include "MainWindow.h"
+#include "HeadlessClient.h"
+#include "StartupTrace.h"
+#include "Logger.h"
+#include "MetricsServer.h"
+#include "StallWatchdog.h"
+#include <QFileInfo>
 #include <QSettings>
 #include <QTranslator>
 
-int main(int argc, char *argv[])
+static void setupApplication()
 {
-    QApplication app(argc, argv);
-
     QCoreApplication::setOrganizationName("chloerei");
     QCoreApplication::setOrganizationDomain("chloerei.com");
     QCoreApplication::setApplicationName("qtalk");
+}
+
+// --log-level or QTALK_LOG_LEVEL: debug, info, warning, error or off
+static void startLogging(const QStringList &arguments)
+{
+    QString name = QString::fromLocal8Bit(qgetenv("QTALK_LOG_LEVEL"));
+    int option = arguments.indexOf("--log-level");
+    if (option > 0 && option + 1 < arguments.count())
+        name = arguments.at(option + 1);
+
+    Logger::start(Logger::defaultFileName(), Logger::levelFromString(name, Logger::Warning));
+}
+
+// --metrics-socket NAME serves the metrics as JSON
+static void startMetricsServer(MetricsServer *server, const QStringList &arguments)
+{
+    int option = arguments.indexOf("--metrics-socket");
+    if (option > 0 && option + 1 < arguments.count())
+        server->listen(arguments.at(option + 1));
+}
+
+// no widget and no display connection, see HeadlessClient for the protocol
+static int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    setupApplication();
+    startLogging(app.arguments());
+
+    MetricsServer metricsServer;
+    startMetricsServer(&metricsServer, app.arguments());
+
+    HeadlessClient client;
+    if (!client.start(app.arguments())) {
+        Logger::stop();
+        return 1;
+    }
+
+    int result = app.exec();
+    Logger::stop();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    StartupTrace::start();
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--headless") == 0)
+            return runHeadless(argc, argv);
+        if (qstrcmp(argv[i], "--trace-startup") == 0)
+            StartupTrace::setEnabled(true);
+    }
+
+    QApplication app(argc, argv);
+    setupApplication();
+    startLogging(app.arguments());
+    StartupTrace::mark("application");
+
+    MetricsServer metricsServer;
+    startMetricsServer(&metricsServer, app.arguments());
+
+    // one window per account, all sharing this process and its caches. A
+    // window frees itself when closed, those still open are freed below
+    for (int account = 0; account < Preferences::accountCount(); account++) {
+        MainWindow *mainWindow = new MainWindow(account);
+        mainWindow->show();
+    }
+    StartupTrace::mark("windows shown");
 
-    MainWindow mainWindow;
-    mainWindow.show();
+    // --stall-threshold MS, 0 turns the watchdog off
+    int threshold = 500;
+    int option = app.arguments().indexOf("--stall-threshold");
+    if (option > 0 && option + 1 < app.arguments().count())
+        threshold = app.arguments().at(option + 1).toInt();
+    StallWatchdog watchdog(threshold);
+    if (threshold > 0)
+        watchdog.start(QFileInfo(Logger::defaultFileName()).absolutePath() + "/stalls.log");
 
-    return app.exec();
+    int result = app.exec();
+    watchdog.stop();
+    foreach (QWidget *widget, QApplication::topLevelWidgets()) {
+        if (qobject_cast<MainWindow *>(widget) != 0)
+            delete widget;
+    }
+    Logger::stop();
+    return result;
 }
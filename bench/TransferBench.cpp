@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "TransferBench.h"
+#include "LoopbackServer.h"
+#include "IncomingFile.h"
+#include "Metrics.h"
+#include "TransferManagerModel.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTimer>
+#include <QXmppClient.h>
+#include <QXmppLogger.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+static const qint64 BlockSize = 1024 * 1024;
+
+TransferBench::TransferBench(const QString &workDir, int timeoutSecs, QObject *parent) :
+    QObject(parent),
+    m_workDir(workDir),
+    m_server(new LoopbackServer(this)),
+    m_sender(new QXmppClient(this)),
+    m_receiver(new QXmppClient(this)),
+    m_model(new TransferManagerModel(this)),
+    m_timeout(new QTimer(this)),
+    m_current(-1),
+    m_connected(0),
+    m_pendingJobs(0),
+    m_incoming(0)
+{
+    QXmppLogger::getLogger()->setLoggingType(QXmppLogger::NONE);
+
+    m_timeout->setSingleShot(true);
+    m_timeout->setInterval(timeoutSecs * 1000);
+    connect(m_timeout, SIGNAL(timeout()),
+            this, SLOT(runTimedOut()) );
+
+    connect(m_sender, SIGNAL(connected()),
+            this, SLOT(clientConnected()) );
+    connect(m_receiver, SIGNAL(connected()),
+            this, SLOT(clientConnected()) );
+    connect(&m_receiver->getTransferManager(), SIGNAL(fileReceived(QXmppTransferJob*)),
+            this, SLOT(fileReceived(QXmppTransferJob*)) );
+}
+
+TransferBench::~TransferBench()
+{
+    delete m_incoming;
+}
+
+void TransferBench::addRun(QXmppTransferJob::Method method, qint64 size)
+{
+    Run run;
+    run.method = method;
+    run.size = size;
+    run.ok = false;
+    run.elapsedMsecs = run.cpuMsecs = run.peakRssKb = 0;
+    run.guiBusyMicros = run.progressUpdates = run.serverBytes = 0;
+    m_runs << run;
+}
+
+bool TransferBench::start()
+{
+    if (!QDir().mkpath(m_workDir) || !m_server->listen())
+        return false;
+
+    m_sender->connectToServer("127.0.0.1", "sender@" + m_server->domain(), "bench", m_server->port());
+    m_receiver->connectToServer("127.0.0.1", "receiver@" + m_server->domain(), "bench", m_server->port());
+    return true;
+}
+
+TransferManagerModel *TransferBench::model() const
+{
+    return m_model;
+}
+
+void TransferBench::clientConnected()
+{
+    if (++m_connected == 2)
+        QTimer::singleShot(0, this, SLOT(startRun()) );
+}
+
+void TransferBench::startRun()
+{
+    if (m_current + 1 >= m_runs.count()) {
+        emit finished();
+        return;
+    }
+
+    m_current++;
+    Run &run = m_runs[m_current];
+    QString path = sourceFile(run.size);
+    if (path.isEmpty()) {
+        fprintf(stderr, "qtalk-bench: can not write a %lld byte file in %s\n",
+                run.size, qPrintable(m_workDir));
+        QTimer::singleShot(0, this, SLOT(startRun()) );
+        return;
+    }
+
+    m_sender->getTransferManager().setSupportedMethods(run.method);
+    m_receiver->getTransferManager().setSupportedMethods(run.method);
+
+    resetPeakRss();
+    Histogram &progress = Metrics::histogram("transfer.model.progress");
+    m_startCpu = cpuMsecs();
+    m_startBusy = progress.sum() + Metrics::histogram("transfer.model.repaint").sum();
+    m_startUpdates = progress.count();
+    m_startServerBytes = m_server->routedBytes();
+    m_pendingJobs = 2;
+    m_clock.start();
+    m_timeout->start();
+
+    // the digest of the offer is part of the cost of sending
+    QXmppTransferJob *job = m_sender->getTransferManager().sendFile(m_receiver->getConfiguration().jid(), path);
+    m_jobs << job;
+    connect(job, SIGNAL(finished()),
+            this, SLOT(jobFinished()) );
+    m_model->addOutgoingJob(job, path);
+}
+
+void TransferBench::fileReceived(QXmppTransferJob *job)
+{
+    m_jobs << job;
+    connect(job, SIGNAL(finished()),
+            this, SLOT(jobFinished()) );
+    m_model->addJobToList(job);
+
+    QString path = m_workDir + "/received.bin";
+    QFile::remove(path);
+    delete m_incoming;
+    m_incoming = new IncomingFile(path);
+    if (m_incoming->open(job->fileSize(), job->fileHash())) {
+        job->accept(m_incoming);
+        m_incoming->setSource(job);
+    } else {
+        fprintf(stderr, "qtalk-bench: %s\n", qPrintable(m_incoming->errorString()));
+        job->abort();
+    }
+}
+
+void TransferBench::jobFinished()
+{
+    QXmppTransferJob *job = static_cast<QXmppTransferJob *>(sender());
+    if (!m_jobs.contains(job) || --m_pendingJobs > 0)
+        return;
+
+    bool ok = true;
+    foreach (QXmppTransferJob *each, m_jobs) {
+        if (each->error() != QXmppTransferJob::NoError)
+            ok = false;
+    }
+    // the incoming side is only done once its writer has caught up
+    if (m_incoming != 0) {
+        ok = m_incoming->finish(ok) && ok;
+        delete m_incoming;
+        m_incoming = 0;
+    }
+    finishRun(ok);
+}
+
+void TransferBench::runTimedOut()
+{
+    foreach (QXmppTransferJob *job, m_jobs) {
+        disconnect(job, 0, this, 0);
+        job->abort();
+    }
+    if (m_incoming != 0) {
+        m_incoming->finish(false);
+        delete m_incoming;
+        m_incoming = 0;
+    }
+    finishRun(false);
+}
+
+void TransferBench::finishRun(bool ok)
+{
+    m_timeout->stop();
+
+    Run &run = m_runs[m_current];
+    Histogram &progress = Metrics::histogram("transfer.model.progress");
+    run.ok = ok;
+    run.elapsedMsecs = m_clock.elapsed();
+    run.cpuMsecs = cpuMsecs() - m_startCpu;
+    run.peakRssKb = peakRssKb();
+    run.guiBusyMicros = progress.sum() + Metrics::histogram("transfer.model.repaint").sum() - m_startBusy;
+    run.progressUpdates = progress.count() - m_startUpdates;
+    run.serverBytes = m_server->routedBytes() - m_startServerBytes;
+
+    foreach (QXmppTransferJob *job, m_jobs) {
+        disconnect(job, 0, this, 0);
+    }
+    m_jobs.clear();
+    m_model->clearJob();
+
+    QString received = m_workDir + "/received.bin";
+    QFile::remove(received);
+    QFile::remove(received + ".part");
+
+    fprintf(stderr, "qtalk-bench: %s %lld bytes %s in %lld ms\n",
+            run.method == QXmppTransferJob::SocksMethod ? "socks" : "ibb",
+            run.size, run.ok ? "sent" : "FAILED", run.elapsedMsecs);
+    QTimer::singleShot(0, this, SLOT(startRun()) );
+}
+
+// one file per size, kept between runs and between invocations
+QString TransferBench::sourceFile(qint64 size)
+{
+    QString path = QString("%1/source-%2.bin").arg(m_workDir).arg(size);
+    if (QFileInfo(path).size() == size)
+        return path;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return QString();
+
+    // random enough not to compress, every block numbered
+    qsrand(uint(size));
+    QByteArray block(int(BlockSize), '\0');
+    for (int i = 0; i < block.size(); i++) {
+        block[i] = char(qrand());
+    }
+    for (qint64 written = 0; written < size; written += BlockSize) {
+        memcpy(block.data(), &written, sizeof(written));
+        qint64 length = qMin(BlockSize, size - written);
+        if (file.write(block.constData(), length) != length) {
+            file.remove();
+            return QString();
+        }
+    }
+    return path;
+}
+
+QString TransferBench::toJson() const
+{
+    QStringList runs;
+    foreach (const Run &run, m_runs) {
+        double seconds = run.elapsedMsecs / 1000.0;
+        runs << QString("{\"method\": \"%1\", \"size\": %2, \"ok\": %3, \"seconds\": %4, "
+                        "\"bytesPerSecond\": %5, \"cpuSeconds\": %6, \"peakRssKb\": %7, "
+                        "\"guiBusyMs\": %8, \"progressUpdates\": %9, \"serverBytes\": %10}")
+                .arg(run.method == QXmppTransferJob::SocksMethod ? "socks" : "ibb")
+                .arg(run.size)
+                .arg(run.ok ? "true" : "false")
+                .arg(seconds, 0, 'f', 3)
+                .arg(seconds > 0 ? qint64(run.size / seconds) : 0)
+                .arg(run.cpuMsecs / 1000.0, 0, 'f', 3)
+                .arg(run.peakRssKb)
+                .arg(run.guiBusyMicros / 1000.0, 0, 'f', 3)
+                .arg(run.progressUpdates)
+                .arg(run.serverBytes);
+    }
+    return QString("{\"qt\": \"%1\", \"runs\": [\n  %2\n]}\n")
+            .arg(qVersion()).arg(runs.join(",\n  "));
+}
+
+qint64 TransferBench::cpuMsecs()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#else
+    return -1;
+#endif
+}
+
+// so every run reports its own peak, not the largest so far
+void TransferBench::resetPeakRss()
+{
+#if defined(Q_OS_LINUX)
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly))
+        clearRefs.write("5");
+#endif
+}
+
+qint64 TransferBench::peakRssKb()
+{
+#if defined(Q_OS_LINUX)
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly)) {
+        foreach (const QByteArray &line, status.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:"))
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+#endif
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRANSFERBENCH_H
+#define TRANSFERBENCH_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QXmppTransferManager.h>
+
+class QTimer;
+class QXmppClient;
+class IncomingFile;
+class LoopbackServer;
+class TransferManagerModel;
+
+// Sends files between two clients on a LoopbackServer, one run at a time,
+// through the same TransferManagerModel, IncomingFile and OutgoingHash code
+// the application uses, and measures every run.
+class TransferBench : public QObject
+{
+    Q_OBJECT
+public:
+    struct Run
+    {
+        QXmppTransferJob::Method method;
+        qint64 size;
+        bool ok;
+        qint64 elapsedMsecs;
+        qint64 cpuMsecs;        // whole process, writer threads included
+        qint64 peakRssKb;
+        qint64 guiBusyMicros;   // inside the model's progress and repaint slots
+        qint64 progressUpdates;
+        qint64 serverBytes;
+    };
+
+    TransferBench(const QString &workDir, int timeoutSecs, QObject *parent = 0);
+    ~TransferBench();
+    void addRun(QXmppTransferJob::Method method, qint64 size);
+    bool start();
+    TransferManagerModel *model() const;
+    QString toJson() const;
+
+signals:
+    void finished();
+
+private slots:
+    void clientConnected();
+    void fileReceived(QXmppTransferJob *job);
+    void jobFinished();
+    void runTimedOut();
+    void startRun();
+
+private:
+    QString m_workDir;
+    LoopbackServer *m_server;
+    QXmppClient *m_sender;
+    QXmppClient *m_receiver;
+    TransferManagerModel *m_model;
+    QTimer *m_timeout;
+    QList<Run> m_runs;
+    int m_current;
+    int m_connected;
+    int m_pendingJobs; // both ends report finished
+    QList<QXmppTransferJob *> m_jobs;
+    IncomingFile *m_incoming;
+    QElapsedTimer m_clock;
+    qint64 m_startCpu;
+    qint64 m_startBusy;
+    qint64 m_startUpdates;
+    qint64 m_startServerBytes;
+
+    QString sourceFile(qint64 size);
+    void finishRun(bool ok);
+    static qint64 cpuMsecs();
+    static void resetPeakRss();
+    static qint64 peakRssKb();
+};
+
+#endif // TRANSFERBENCH_H
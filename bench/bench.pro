@@ -0,0 +1,32 @@
+TEMPLATE = app
+TARGET = qtalk-bench
+QT += network xml
+
+# Loopback transfer benchmark, see main.cpp for the options.
+
+CONFIG += console release
+CONFIG -= app_bundle
+INCLUDEPATH += ../lib/QXmppClient/source ../app ../server
+
+QXMPP_LIB = QXmppClient
+QXMPP_DIR = ../lib/QXmppClient/source/release
+LIBS += -L$$QXMPP_DIR -l$$QXMPP_LIB
+PRE_TARGETDEPS += $${QXMPP_DIR}/lib$${QXMPP_LIB}.a
+
+# measure the code the application ships, not a copy of it
+SOURCES += main.cpp \
+           ../server/LoopbackServer.cpp \
+           TransferBench.cpp \
+           ../app/TransferManagerModel.cpp \
+           ../app/TransferRate.cpp \
+           ../app/IncomingFile.cpp \
+           ../app/OutgoingHash.cpp \
+           ../app/Metrics.cpp \
+           ../app/Logger.cpp \
+           ../app/RotatingFile.cpp \
+           ../app/StallWatchdog.cpp
+HEADERS += ../server/LoopbackServer.h \
+           TransferBench.h \
+           ../app/TransferManagerModel.h \
+           ../app/IncomingFile.h \
+           ../app/StallWatchdog.h
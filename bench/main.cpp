@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QApplication>
+#include <QFile>
+#include <QDir>
+#include <QStringList>
+#include <QTableView>
+#include "TransferBench.h"
+#include "TransferManagerModel.h"
+#include "Logger.h"
+#include <stdio.h>
+
+// qtalk-bench [--sizes 1M,16M,256M,4G] [--methods socks,ibb] [--ibb-limit 256M]
+//             [--dir DIR] [--timeout SECS] [--output FILE] [--view]
+//
+// Transfers every size with every method between two clients on a
+// loopback server and prints one JSON object with a line per run.
+
+static QString option(const QStringList &arguments, const QString &name, const QString &defaultValue)
+{
+    int index = arguments.indexOf(name);
+    if (index > 0 && index + 1 < arguments.count())
+        return arguments.at(index + 1);
+    return defaultValue;
+}
+
+// 512K, 16M, 4G or plain bytes
+static qint64 parseSize(const QString &text)
+{
+    QString number = text.trimmed().toUpper();
+    qint64 unit = 1;
+    if (number.endsWith('K'))
+        unit = 1024;
+    else if (number.endsWith('M'))
+        unit = 1024 * 1024;
+    else if (number.endsWith('G'))
+        unit = Q_INT64_C(1024) * 1024 * 1024;
+    if (unit != 1)
+        number.chop(1);
+    return number.toLongLong() * unit;
+}
+
+int main(int argc, char *argv[])
+{
+    bool view = false;
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--view") == 0)
+            view = true;
+    }
+
+    // the model repaints into a real view only when asked to, so the
+    // default run needs no display
+    QApplication app(argc, argv, view);
+    Logger::setLevel(Logger::Off);
+    QStringList arguments = app.arguments();
+
+    QStringList sizes = option(arguments, "--sizes", "1M,16M,256M,4G").split(',', QString::SkipEmptyParts);
+    QStringList methods = option(arguments, "--methods", "socks,ibb").split(',', QString::SkipEmptyParts);
+    // in-band data is base64 in stanzas, gigabytes of it take hours
+    qint64 ibbLimit = parseSize(option(arguments, "--ibb-limit", "256M"));
+    QString workDir = option(arguments, "--dir", QDir::tempPath() + "/qtalk-bench");
+    int timeout = option(arguments, "--timeout", "1800").toInt();
+    QString output = option(arguments, "--output", QString());
+
+    TransferBench bench(workDir, timeout);
+    foreach (const QString &method, methods) {
+        foreach (const QString &text, sizes) {
+            qint64 size = parseSize(text);
+            if (size <= 0)
+                continue;
+            if (method == "socks")
+                bench.addRun(QXmppTransferJob::SocksMethod, size);
+            else if (method == "ibb" && size <= ibbLimit)
+                bench.addRun(QXmppTransferJob::InBandMethod, size);
+        }
+    }
+
+    QTableView *tableView = 0;
+    if (view) {
+        tableView = new QTableView;
+        tableView->setModel(bench.model());
+        tableView->show();
+    }
+
+    QObject::connect(&bench, SIGNAL(finished()),
+                     &app, SLOT(quit()) );
+    if (!bench.start()) {
+        fprintf(stderr, "qtalk-bench: can not listen on 127.0.0.1 or create %s\n", qPrintable(workDir));
+        return 1;
+    }
+    app.exec();
+    delete tableView;
+
+    QString json = bench.toJson();
+    if (output.isEmpty()) {
+        fputs(json.toUtf8().constData(), stdout);
+    } else {
+        QFile file(output);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "qtalk-bench: can not write %s\n", qPrintable(output));
+            return 1;
+        }
+        file.write(json.toUtf8());
+    }
+    return 0;
+}
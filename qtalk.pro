@@ -1,4 +1,4 @@
 TEMPLATE = subdirs
-SUBDIRS = lib app
+SUBDIRS = lib app server bench tests
 
 CONFIG += ordered
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "LoadGenerator.h"
+#include "LoopbackServer.h"
+#include <QTimer>
+
+static const int TickInterval = 10;
+
+LoadGenerator::LoadGenerator(LoopbackServer *server, QObject *parent) :
+    QObject(parent),
+    m_server(server),
+    m_timer(new QTimer(this)),
+    m_churnRate(0),
+    m_churnStart(0),
+    m_churnDone(0),
+    m_floodRate(0),
+    m_floodCount(0),
+    m_floodStart(0),
+    m_floodDone(0),
+    m_presenceSent(0),
+    m_messagesSent(0)
+{
+    m_timer->setInterval(TickInterval);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(tick()) );
+    m_clock.start();
+}
+
+// contactN@load.<domain> in ten groups, half of them online
+void LoadGenerator::populate(const QString &bareJid, int count)
+{
+    for (int i = 0; i < count; i++) {
+        QString contact = QString("contact%1@load.%2").arg(i).arg(m_server->domain());
+        m_server->addContact(bareJid, contact, QString("Contact %1").arg(i),
+                             QString("Load %1").arg(i % 10));
+        m_server->setContactPresence(contact, i % 2 == 0 ? "online" : "unavailable");
+    }
+}
+
+void LoadGenerator::setPresenceChurn(const QString &bareJid, int perSecond)
+{
+    m_churnTarget = bareJid;
+    m_churnRate = qMax(0, perSecond);
+    m_churnStart = m_clock.elapsed();
+    m_churnDone = 0;
+    updateTimer();
+}
+
+void LoadGenerator::flood(const QString &bareJid, int count, int perSecond)
+{
+    m_floodTarget = bareJid;
+    m_floodCount = qMax(0, count);
+    m_floodRate = qMax(0, perSecond);
+    m_floodStart = m_clock.elapsed();
+    m_floodDone = 0;
+    updateTimer();
+}
+
+qint64 LoadGenerator::presenceSent() const
+{
+    return m_presenceSent;
+}
+
+qint64 LoadGenerator::messagesSent() const
+{
+    return m_messagesSent;
+}
+
+void LoadGenerator::tick()
+{
+    static const char *shows[] = { "online", "chat", "away", "xa", "dnd", "unavailable" };
+    qint64 now = m_clock.elapsed();
+
+    if (m_churnRate > 0) {
+        qint64 due = (now - m_churnStart) * m_churnRate / 1000;
+        QStringList contacts = m_server->contacts(m_churnTarget);
+        for (; m_churnDone < due && !contacts.isEmpty(); m_churnDone++) {
+            QString contact = contacts.at(qrand() % contacts.count());
+            m_server->setContactPresence(contact, shows[qrand() % 6],
+                                         QString("churn %1").arg(m_presenceSent));
+            m_presenceSent++;
+        }
+    }
+
+    if (m_floodDone < m_floodCount) {
+        // no rate sends the whole flood at once
+        qint64 due = m_floodRate > 0 ? (now - m_floodStart) * m_floodRate / 1000 : m_floodCount;
+        due = qMin(due, qint64(m_floodCount));
+        QStringList contacts = m_server->contacts(m_floodTarget);
+        if (contacts.isEmpty())
+            contacts << "flood@load." + m_server->domain();
+        for (; m_floodDone < due; m_floodDone++) {
+            QString contact = contacts.at(qrand() % contacts.count());
+            m_server->sendMessage(contact, m_floodTarget, QString("flood %1").arg(m_floodDone));
+            m_messagesSent++;
+        }
+    }
+
+    updateTimer();
+}
+
+void LoadGenerator::updateTimer()
+{
+    if (m_churnRate == 0 && m_floodDone >= m_floodCount)
+        m_timer->stop();
+    else if (!m_timer->isActive())
+        m_timer->start();
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+
+class QTimer;
+class LoopbackServer;
+
+// Synthetic traffic from simulated contacts: fills a roster, changes their
+// presence at a steady rate, and floods messages. Rates are kept over time,
+// not per tick, so a busy event loop catches up instead of falling behind.
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoadGenerator(LoopbackServer *server, QObject *parent = 0);
+    void populate(const QString &bareJid, int count);
+    void setPresenceChurn(const QString &bareJid, int perSecond);
+    void flood(const QString &bareJid, int count, int perSecond);
+    qint64 presenceSent() const;
+    qint64 messagesSent() const;
+
+private slots:
+    void tick();
+
+private:
+    LoopbackServer *m_server;
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+
+    QString m_churnTarget;
+    int m_churnRate;
+    qint64 m_churnStart;
+    qint64 m_churnDone;
+
+    QString m_floodTarget;
+    int m_floodRate;
+    int m_floodCount;
+    qint64 m_floodStart;
+    qint64 m_floodDone;
+
+    qint64 m_presenceSent;
+    qint64 m_messagesSent;
+
+    void updateTimer();
+};
+
+#endif // LOADGENERATOR_H
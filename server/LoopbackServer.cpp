@@ -0,0 +1,654 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "LoopbackServer.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QXmlStreamReader>
+
+static const char *StreamNs = "http://etherx.jabber.org/streams";
+static const char *SaslNs = "urn:ietf:params:xml:ns:xmpp-sasl";
+static const char *BindNs = "urn:ietf:params:xml:ns:xmpp-bind";
+static const char *SessionNs = "urn:ietf:params:xml:ns:xmpp-session";
+static const char *AuthNs = "jabber:iq:auth";
+static const char *RosterNs = "jabber:iq:roster";
+static const char *VCardNs = "vcard-temp";
+
+struct LoopbackServer::Session
+{
+    Session() : depth(0), authenticated(false), restart(false), interested(false) {}
+
+    QTcpSocket *socket;
+    QXmlStreamReader reader;
+    QDomDocument document;
+    QList<QDomElement> open; // the stanza being read, outermost first
+    int depth;
+    bool authenticated;
+    bool restart; // a new stream follows SASL success
+    bool interested; // asked for the roster, gets pushes
+    QString user;
+    QString jid; // empty until bound
+    QByteArray presence; // last available presence, empty when offline
+};
+
+LoopbackServer::LoopbackServer(QObject *parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this)),
+    m_nextId(0),
+    m_routedBytes(0),
+    m_injectedStanzas(0)
+{
+    connect(m_server, SIGNAL(newConnection()),
+            this, SLOT(newConnection()) );
+}
+
+LoopbackServer::~LoopbackServer()
+{
+    qDeleteAll(m_sessions);
+}
+
+bool LoopbackServer::listen(quint16 port)
+{
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+quint16 LoopbackServer::port() const
+{
+    return m_server->serverPort();
+}
+
+QString LoopbackServer::domain() const
+{
+    return "localhost";
+}
+
+qint64 LoopbackServer::routedBytes() const
+{
+    return m_routedBytes;
+}
+
+qint64 LoopbackServer::injectedStanzas() const
+{
+    return m_injectedStanzas;
+}
+
+QStringList LoopbackServer::sessions() const
+{
+    QStringList sessions;
+    foreach (Session *session, m_sessions) {
+        if (!session->jid.isEmpty())
+            sessions << QString("%1 %2").arg(session->jid)
+                        .arg(session->presence.isEmpty() ? "unavailable" : "available");
+    }
+    sessions.sort();
+    return sessions;
+}
+
+void LoopbackServer::addContact(const QString &bareJid, const QString &contact,
+                                const QString &name, const QString &group)
+{
+    RosterItem &item = m_accounts[bareJid].roster[contact];
+    item.name = name;
+    item.group = group;
+    item.subscription = "both";
+    pushRosterItem(bareJid, contact);
+    foreach (Session *session, sessionsOf(bareJid)) {
+        if (!session->presence.isEmpty())
+            sendPresenceOf(contact, session);
+    }
+}
+
+void LoopbackServer::removeContact(const QString &bareJid, const QString &contact)
+{
+    if (m_accounts.contains(bareJid) && m_accounts[bareJid].roster.remove(contact) > 0)
+        pushRosterItem(bareJid, contact);
+}
+
+QStringList LoopbackServer::contacts(const QString &bareJid) const
+{
+    return m_accounts.value(bareJid).roster.keys();
+}
+
+// show is one of online, chat, away, xa, dnd or unavailable
+void LoopbackServer::setContactPresence(const QString &contact, const QString &show, const QString &status)
+{
+    QString stanza;
+    if (show == "unavailable") {
+        m_contactPresence.remove(contact);
+        stanza = QString("<presence type='unavailable' from='%1/loopback'/>").arg(quote(contact));
+    } else {
+        stanza = QString("<presence from='%1/loopback'>%2%3</presence>")
+                .arg(quote(contact))
+                .arg(show.isEmpty() || show == "online" ? QString() : QString("<show>%1</show>").arg(quote(show)))
+                .arg(status.isEmpty() ? QString() : QString("<status>%1</status>").arg(quote(status)));
+        m_contactPresence.insert(contact, stanza);
+    }
+
+    QByteArray data = stanza.toUtf8();
+    foreach (Session *session, m_sessions) {
+        if (!session->presence.isEmpty()
+                && m_accounts.value(bare(session->jid)).roster.contains(contact)) {
+            send(session, data);
+            m_injectedStanzas++;
+        }
+    }
+}
+
+void LoopbackServer::sendMessage(const QString &from, const QString &to, const QString &body)
+{
+    QByteArray data = QString("<message type='chat' from='%1' to='%2'><body>%3</body></message>")
+            .arg(quote(from.contains('/') ? from : from + "/loopback"))
+            .arg(quote(to))
+            .arg(quote(body)).toUtf8();
+    foreach (Session *session, sessionsOf(bare(to))) {
+        if (!to.contains('/') || session->jid == to) {
+            send(session, data);
+            m_injectedStanzas++;
+        }
+    }
+}
+
+void LoopbackServer::newConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        Session *session = new Session;
+        session->socket = socket;
+        m_sessions.insert(socket, session);
+        connect(socket, SIGNAL(readyRead()),
+                this, SLOT(readyRead()) );
+        connect(socket, SIGNAL(disconnected()),
+                this, SLOT(disconnected()) );
+    }
+}
+
+void LoopbackServer::disconnected()
+{
+    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
+    Session *session = m_sessions.value(socket);
+    if (session != 0 && !session->presence.isEmpty()) {
+        session->presence.clear();
+        broadcastPresence(session, QString("<presence type='unavailable' from='%1'/>")
+                          .arg(quote(session->jid)).toUtf8());
+    }
+    delete m_sessions.take(socket);
+    socket->deleteLater();
+}
+
+void LoopbackServer::readyRead()
+{
+    QTcpSocket *socket = static_cast<QTcpSocket *>(sender());
+    Session *session = m_sessions.value(socket);
+    if (session == 0)
+        return;
+
+    // stanzas are rebuilt as DOM elements, a partial one stays on the
+    // stack until the rest arrives
+    QXmlStreamReader &reader = session->reader;
+    reader.addData(socket->readAll());
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement:
+            if (session->depth == 0) {
+                startStream(session);
+            } else {
+                QDomElement element = session->document.createElementNS(
+                        reader.namespaceUri().toString(), reader.qualifiedName().toString());
+                foreach (const QXmlStreamAttribute &attribute, reader.attributes()) {
+                    if (attribute.namespaceUri().isEmpty())
+                        element.setAttribute(attribute.name().toString(), attribute.value().toString());
+                    else
+                        element.setAttributeNS(attribute.namespaceUri().toString(),
+                                               attribute.qualifiedName().toString(),
+                                               attribute.value().toString());
+                }
+                if (!session->open.isEmpty())
+                    session->open.last().appendChild(element);
+                session->open.append(element);
+            }
+            session->depth++;
+            break;
+        case QXmlStreamReader::EndElement:
+            session->depth--;
+            if (session->depth == 0) {
+                send(session, "</stream:stream>");
+                socket->disconnectFromHost();
+                return;
+            } else {
+                QDomElement element = session->open.takeLast();
+                if (session->open.isEmpty())
+                    handleElement(session, element);
+            }
+            break;
+        case QXmlStreamReader::Characters:
+            if (!session->open.isEmpty())
+                session->open.last().appendChild(session->document.createTextNode(reader.text().toString()));
+            break;
+        default:
+            break;
+        }
+
+        if (session->restart) {
+            // the client starts over with a new header after SASL
+            reader.clear();
+            session->open.clear();
+            session->depth = 0;
+            session->restart = false;
+            return;
+        }
+    }
+
+    if (reader.hasError() && reader.error() != QXmlStreamReader::PrematureEndOfDocumentError)
+        socket->disconnectFromHost();
+}
+
+void LoopbackServer::startStream(Session *session)
+{
+    QString header = QString("<?xml version='1.0' encoding='UTF-8'?>"
+                             "<stream:stream xmlns='jabber:client' xmlns:stream='%1'"
+                             " id='loopback%2' from='%3' version='1.0'>")
+            .arg(StreamNs).arg(++m_nextId).arg(domain());
+    QString features;
+    if (!session->authenticated)
+        features = QString("<mechanisms xmlns='%1'><mechanism>PLAIN</mechanism></mechanisms>"
+                           "<auth xmlns='http://jabber.org/features/iq-auth'/>").arg(SaslNs);
+    else
+        features = QString("<bind xmlns='%1'/><session xmlns='%2'/>").arg(BindNs).arg(SessionNs);
+    send(session, QString("%1<stream:features>%2</stream:features>").arg(header).arg(features).toUtf8());
+}
+
+void LoopbackServer::handleElement(Session *session, const QDomElement &element)
+{
+    if (element.namespaceURI() == SaslNs) {
+        handleSasl(session, element);
+        return;
+    }
+
+    QString to = element.attribute("to");
+    if (element.tagName() == "iq") {
+        if (to.isEmpty() || to == domain() || to == bare(session->jid)) {
+            handleIq(session, element);
+            return;
+        }
+        // vCards are kept by the server, also for simulated contacts
+        if (!to.contains('/') && !session->jid.isEmpty()
+                && element.firstChildElement().namespaceURI() == VCardNs) {
+            handleVCard(session, element);
+            return;
+        }
+    }
+
+    // nothing goes anywhere before binding
+    if (session->jid.isEmpty())
+        return;
+    if (element.tagName() == "presence")
+        handlePresence(session, element);
+    else if (!to.isEmpty())
+        route(session, element);
+}
+
+void LoopbackServer::handleSasl(Session *session, const QDomElement &auth)
+{
+    if (auth.tagName() != "auth" || auth.attribute("mechanism") != "PLAIN") {
+        send(session, QString("<failure xmlns='%1'><invalid-mechanism/></failure>").arg(SaslNs).toUtf8());
+        return;
+    }
+
+    // [authzid] NUL user NUL password, the password is not checked
+    QList<QByteArray> fields = QByteArray::fromBase64(auth.text().toAscii()).split('\0');
+    session->user = QString::fromUtf8(fields.value(1));
+    session->authenticated = !session->user.isEmpty();
+    if (session->authenticated) {
+        send(session, QString("<success xmlns='%1'/>").arg(SaslNs).toUtf8());
+        session->restart = true;
+    } else {
+        send(session, QString("<failure xmlns='%1'><not-authorized/></failure>").arg(SaslNs).toUtf8());
+    }
+}
+
+void LoopbackServer::handleIq(Session *session, const QDomElement &iq)
+{
+    QString type = iq.attribute("type");
+    if (type == "result" || type == "error")
+        return;
+
+    QDomElement query = iq.firstChildElement();
+    QString ns = query.namespaceURI();
+
+    if (ns == AuthNs) {
+        if (type == "get") {
+            sendResult(session, iq, QString("<query xmlns='%1'><username/><password/><resource/></query>").arg(AuthNs));
+        } else {
+            session->user = query.firstChildElement("username").text();
+            session->authenticated = !session->user.isEmpty();
+            if (!session->authenticated) {
+                sendError(session, iq, "not-authorized");
+                return;
+            }
+            bind(session, query.firstChildElement("resource").text());
+            sendResult(session, iq);
+        }
+        return;
+    }
+
+    if (!session->authenticated) {
+        sendError(session, iq, "not-authorized");
+        return;
+    }
+
+    if (ns == BindNs && type == "set") {
+        bind(session, query.firstChildElement("resource").text());
+        sendResult(session, iq, QString("<bind xmlns='%1'><jid>%2</jid></bind>")
+                   .arg(BindNs).arg(quote(session->jid)));
+    } else if (session->jid.isEmpty()) {
+        sendError(session, iq, "not-authorized");
+    } else if (ns == SessionNs && type == "set") {
+        sendResult(session, iq);
+    } else if (ns == RosterNs && type == "get") {
+        session->interested = true;
+        const Account account = m_accounts.value(bare(session->jid));
+        QString items;
+        QMap<QString, RosterItem>::const_iterator it;
+        for (it = account.roster.constBegin(); it != account.roster.constEnd(); ++it) {
+            items += rosterItemXml(it.key(), it.value());
+        }
+        sendResult(session, iq, QString("<query xmlns='%1'>%2</query>").arg(RosterNs).arg(items));
+    } else if (ns == RosterNs && type == "set") {
+        handleRosterSet(session, iq);
+    } else if (ns == VCardNs) {
+        handleVCard(session, iq);
+    } else if (type == "get" && (ns == "http://jabber.org/protocol/disco#info"
+                                 || ns == "http://jabber.org/protocol/disco#items")) {
+        sendResult(session, iq, QString("<query xmlns='%1'/>").arg(ns));
+    } else {
+        sendError(session, iq, "service-unavailable");
+    }
+}
+
+void LoopbackServer::handleRosterSet(Session *session, const QDomElement &iq)
+{
+    QDomElement item = iq.firstChildElement().firstChildElement("item");
+    QString contact = bare(item.attribute("jid"));
+    if (contact.isEmpty()) {
+        sendError(session, iq, "bad-request");
+        return;
+    }
+
+    QString owner = bare(session->jid);
+    if (item.attribute("subscription") == "remove") {
+        removeContact(owner, contact);
+    } else {
+        RosterItem &entry = m_accounts[owner].roster[contact];
+        entry.name = item.attribute("name");
+        entry.group = item.firstChildElement("group").text();
+        if (entry.subscription.isEmpty())
+            entry.subscription = "none";
+        pushRosterItem(owner, contact);
+    }
+    sendResult(session, iq);
+}
+
+void LoopbackServer::handleVCard(Session *session, const QDomElement &iq)
+{
+    QString type = iq.attribute("type");
+    QString owner = bare(session->jid);
+    QString target = iq.attribute("to").isEmpty() ? owner : bare(iq.attribute("to"));
+
+    if (type == "set") {
+        if (target != owner) {
+            sendError(session, iq, "forbidden");
+            return;
+        }
+        m_accounts[owner].vCard = QString::fromUtf8(toXml(iq.firstChildElement()));
+        sendResult(session, iq);
+        return;
+    }
+    if (type != "get")
+        return;
+
+    QString vCard = m_accounts.value(target).vCard;
+    if (vCard.isEmpty()) {
+        // a simulated contact is known by its name in the roster
+        QString name = m_accounts.value(owner).roster.value(target).name;
+        if (name.isEmpty())
+            vCard = QString("<vCard xmlns='%1'/>").arg(VCardNs);
+        else
+            vCard = QString("<vCard xmlns='%1'><FN>%2</FN><NICKNAME>%2</NICKNAME></vCard>")
+                    .arg(VCardNs).arg(quote(name));
+    }
+    sendResult(session, iq, vCard);
+}
+
+void LoopbackServer::handlePresence(Session *session, QDomElement presence)
+{
+    QString type = presence.attribute("type");
+    QString to = presence.attribute("to");
+    QString owner = bare(session->jid);
+    presence.setAttribute("from", session->jid);
+
+    if (to.isEmpty()) {
+        if (!type.isEmpty() && type != "unavailable")
+            return;
+        bool initial = session->presence.isEmpty();
+        QByteArray data = toXml(presence);
+        session->presence = type.isEmpty() ? data : QByteArray();
+        broadcastPresence(session, data);
+        // the first presence is answered with those of the contacts
+        if (initial && type.isEmpty()) {
+            foreach (const QString &contact, m_accounts.value(owner).roster.keys()) {
+                sendPresenceOf(contact, session);
+            }
+        }
+        return;
+    }
+
+    QString contact = bare(to);
+    if (isSimulated(contact)) {
+        // simulated contacts approve every request
+        if (type == "subscribe") {
+            m_accounts[owner].roster[contact].subscription = "both";
+            pushRosterItem(owner, contact);
+            send(session, QString("<presence type='subscribed' from='%1' to='%2'/>")
+                 .arg(quote(contact)).arg(quote(session->jid)).toUtf8());
+            sendPresenceOf(contact, session);
+            m_injectedStanzas++;
+        }
+        return;
+    }
+
+    // an approval puts both in each other's roster
+    if (type == "subscribed") {
+        m_accounts[owner].roster[contact].subscription = "both";
+        m_accounts[contact].roster[owner].subscription = "both";
+        pushRosterItem(owner, contact);
+        pushRosterItem(contact, owner);
+    }
+
+    QByteArray data = toXml(presence);
+    foreach (Session *target, sessionsOf(contact)) {
+        if (!to.contains('/') || target->jid == to) {
+            send(target, data);
+            m_routedBytes += data.size();
+        }
+    }
+}
+
+void LoopbackServer::route(Session *session, QDomElement stanza)
+{
+    Session *target = findSession(stanza.attribute("to"));
+    if (target == 0) {
+        QString type = stanza.attribute("type");
+        if (stanza.tagName() == "iq" && (type == "get" || type == "set"))
+            sendError(session, stanza, "service-unavailable");
+        return;
+    }
+
+    stanza.setAttribute("from", session->jid);
+    QByteArray data = toXml(stanza);
+    m_routedBytes += data.size();
+    send(target, data);
+}
+
+void LoopbackServer::bind(Session *session, const QString &resource)
+{
+    QString bareJid = QString("%1@%2").arg(session->user).arg(domain());
+    QString jid = bareJid + "/" + (resource.isEmpty() ? QString("loopback") : resource);
+    if (findSession(jid) != 0)
+        jid += QString::number(++m_nextId);
+    session->jid = jid;
+    m_accounts[bareJid];
+}
+
+void LoopbackServer::pushRosterItem(const QString &bareJid, const QString &contact)
+{
+    const QMap<QString, RosterItem> roster = m_accounts.value(bareJid).roster;
+    RosterItem removed;
+    removed.subscription = "remove";
+    QString item = rosterItemXml(contact, roster.contains(contact) ? roster.value(contact) : removed);
+
+    foreach (Session *session, sessionsOf(bareJid)) {
+        if (session->interested)
+            send(session, QString("<iq type='set' id='push%1' to='%2'><query xmlns='%3'>%4</query></iq>")
+                 .arg(++m_nextId).arg(quote(session->jid)).arg(RosterNs).arg(item).toUtf8());
+    }
+}
+
+void LoopbackServer::sendPresenceOf(const QString &contact, Session *session)
+{
+    if (m_contactPresence.contains(contact)) {
+        send(session, m_contactPresence.value(contact).toUtf8());
+        m_injectedStanzas++;
+        return;
+    }
+    foreach (Session *other, sessionsOf(contact)) {
+        if (!other->presence.isEmpty())
+            send(session, other->presence);
+    }
+}
+
+// to the other sessions of the account and everyone with it in the roster
+void LoopbackServer::broadcastPresence(Session *session, const QByteArray &presence)
+{
+    QString owner = bare(session->jid);
+    foreach (Session *other, m_sessions) {
+        if (other == session || other->jid.isEmpty())
+            continue;
+        QString otherBare = bare(other->jid);
+        if (otherBare == owner || m_accounts.value(otherBare).roster.contains(owner)) {
+            send(other, presence);
+            m_routedBytes += presence.size();
+        }
+    }
+}
+
+QList<LoopbackServer::Session *> LoopbackServer::sessionsOf(const QString &bareJid) const
+{
+    QList<Session *> sessions;
+    foreach (Session *session, m_sessions) {
+        if (!session->jid.isEmpty() && bare(session->jid) == bareJid)
+            sessions << session;
+    }
+    return sessions;
+}
+
+// a full jid picks that session, a bare jid the first session of the user
+LoopbackServer::Session *LoopbackServer::findSession(const QString &jid) const
+{
+    bool isBare = !jid.contains('/');
+    foreach (Session *session, m_sessions) {
+        if (session->jid.isEmpty())
+            continue;
+        if (session->jid == jid || (isBare && bare(session->jid) == jid))
+            return session;
+    }
+    return 0;
+}
+
+// anyone who never logged in is played by the server
+bool LoopbackServer::isSimulated(const QString &bareJid) const
+{
+    return !m_accounts.contains(bareJid);
+}
+
+void LoopbackServer::sendResult(Session *session, const QDomElement &iq, const QString &payload)
+{
+    send(session, QString("<iq type='result' id='%1' from='%2'>%3</iq>")
+         .arg(quote(iq.attribute("id")))
+         .arg(quote(iq.attribute("to", domain())))
+         .arg(payload).toUtf8());
+}
+
+void LoopbackServer::sendError(Session *session, const QDomElement &stanza, const QString &condition)
+{
+    send(session, QString("<%1 type='error' id='%2' from='%3'><error type='cancel'>"
+                          "<%4 xmlns='urn:ietf:params:xml:ns:xmpp-stanzas'/></error></%1>")
+         .arg(stanza.tagName())
+         .arg(quote(stanza.attribute("id")))
+         .arg(quote(stanza.attribute("to", domain())))
+         .arg(condition).toUtf8());
+}
+
+void LoopbackServer::send(Session *session, const QByteArray &data)
+{
+    session->socket->write(data);
+}
+
+QString LoopbackServer::rosterItemXml(const QString &contact, const RosterItem &item)
+{
+    QString xml = QString("<item jid='%1' subscription='%2'").arg(quote(contact)).arg(item.subscription);
+    if (!item.name.isEmpty())
+        xml += QString(" name='%1'").arg(quote(item.name));
+    if (item.group.isEmpty())
+        return xml + "/>";
+    return xml + QString("><group>%1</group></item>").arg(quote(item.group));
+}
+
+QByteArray LoopbackServer::toXml(const QDomElement &element)
+{
+    QString data;
+    QTextStream stream(&data);
+    element.save(stream, 0);
+    stream.flush();
+    return data.toUtf8();
+}
+
+QString LoopbackServer::bare(const QString &jid)
+{
+    return jid.section('/', 0, 0);
+}
+
+QString LoopbackServer::quote(const QString &text)
+{
+    QString quoted = text;
+    quoted.replace('&', "&amp;");
+    quoted.replace('<', "&lt;");
+    quoted.replace('>', "&gt;");
+    quoted.replace('\'', "&apos;");
+    quoted.replace('"', "&quot;");
+    return quoted;
+}
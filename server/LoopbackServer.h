@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LOOPBACKSERVER_H
+#define LOOPBACKSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QDomElement>
+
+class QTcpServer;
+class QTcpSocket;
+
+// A small XMPP server on 127.0.0.1 for running clients without a real
+// one: SASL PLAIN or jabber:iq:auth with any password, resource binding,
+// rosters with pushes, presence fan-out, vCards, and routing of messages
+// and bytestream IQs between sessions. Accounts are created on first
+// login and live as long as the server.
+//
+// Contacts that are not accounts are simulated: addContact() puts them in
+// a roster, setContactPresence() and sendMessage() speak for them. This is
+// what LoadGenerator drives. Nothing is encrypted or stored on disk.
+class LoopbackServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoopbackServer(QObject *parent = 0);
+    ~LoopbackServer();
+    bool listen(quint16 port = 0);
+    quint16 port() const;
+    QString domain() const;
+    qint64 routedBytes() const; // stanzas passed from one session to another
+    qint64 injectedStanzas() const; // sent on behalf of simulated contacts
+    QStringList sessions() const;
+
+    void addContact(const QString &bareJid, const QString &contact,
+                    const QString &name = QString(), const QString &group = QString());
+    void removeContact(const QString &bareJid, const QString &contact);
+    QStringList contacts(const QString &bareJid) const;
+    void setContactPresence(const QString &contact, const QString &show, const QString &status = QString());
+    void sendMessage(const QString &from, const QString &to, const QString &body);
+
+private slots:
+    void newConnection();
+    void readyRead();
+    void disconnected();
+
+private:
+    struct Session;
+    struct RosterItem
+    {
+        QString name;
+        QString group;
+        QString subscription;
+    };
+    struct Account
+    {
+        QMap<QString, RosterItem> roster;
+        QString vCard; // as set by the client, empty for none
+    };
+
+    QTcpServer *m_server;
+    QHash<QTcpSocket *, Session *> m_sessions;
+    QHash<QString, Account> m_accounts;
+    QHash<QString, QString> m_contactPresence; // simulated contacts that are online
+    int m_nextId;
+    qint64 m_routedBytes;
+    qint64 m_injectedStanzas;
+
+    void startStream(Session *session);
+    void handleElement(Session *session, const QDomElement &element);
+    void handleSasl(Session *session, const QDomElement &auth);
+    void handleIq(Session *session, const QDomElement &iq);
+    void handleRosterSet(Session *session, const QDomElement &iq);
+    void handleVCard(Session *session, const QDomElement &iq);
+    void handlePresence(Session *session, QDomElement presence);
+    void route(Session *session, QDomElement stanza);
+    void bind(Session *session, const QString &resource);
+    void pushRosterItem(const QString &bareJid, const QString &contact);
+    void sendPresenceOf(const QString &contact, Session *session);
+    void broadcastPresence(Session *session, const QByteArray &presence);
+    QList<Session *> sessionsOf(const QString &bareJid) const;
+    Session *findSession(const QString &jid) const;
+    bool isSimulated(const QString &bareJid) const;
+    void sendResult(Session *session, const QDomElement &iq, const QString &payload = QString());
+    void sendError(Session *session, const QDomElement &stanza, const QString &condition);
+    void send(Session *session, const QByteArray &data);
+    static QString rosterItemXml(const QString &contact, const RosterItem &item);
+    static QByteArray toXml(const QDomElement &element);
+    static QString bare(const QString &jid);
+    static QString quote(const QString &text);
+};
+
+#endif // LOOPBACKSERVER_H
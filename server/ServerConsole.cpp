@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ServerConsole.h"
+#include "LoopbackServer.h"
+#include "LoadGenerator.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <stdio.h>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+ServerConsole::ServerConsole(LoopbackServer *server, LoadGenerator *generator, QObject *parent) :
+    QObject(parent),
+    m_server(server),
+    m_generator(generator),
+    m_stdinNotifier(0),
+    m_sleepTimer(new QTimer(this))
+{
+    m_sleepTimer->setSingleShot(true);
+    connect(m_sleepTimer, SIGNAL(timeout()),
+            this, SLOT(runPending()) );
+}
+
+bool ServerConsole::runScript(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            m_pending << line;
+    }
+    runPending();
+    return true;
+}
+
+void ServerConsole::readStdin()
+{
+#ifdef Q_OS_UNIX
+    m_stdinNotifier = new QSocketNotifier(STDIN_FILENO, QSocketNotifier::Read, this);
+    connect(m_stdinNotifier, SIGNAL(activated(int)),
+            this, SLOT(stdinReadyRead()) );
+#endif
+}
+
+void ServerConsole::stdinReadyRead()
+{
+#ifdef Q_OS_UNIX
+    char buffer[4096];
+    ssize_t size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (size <= 0) {
+        // stdin closed, the server keeps running for its clients
+        m_stdinNotifier->setEnabled(false);
+        return;
+    }
+
+    m_stdinBuffer.append(buffer, size);
+    int pos;
+    while ((pos = m_stdinBuffer.indexOf('\n')) >= 0) {
+        QString line = QString::fromUtf8(m_stdinBuffer.left(pos)).trimmed();
+        m_stdinBuffer.remove(0, pos + 1);
+        if (!line.isEmpty())
+            m_pending << line;
+    }
+    runPending();
+#endif
+}
+
+void ServerConsole::runPending()
+{
+    while (!m_pending.isEmpty() && !m_sleepTimer->isActive()) {
+        handleCommand(m_pending.takeFirst());
+    }
+}
+
+void ServerConsole::handleCommand(const QString &line)
+{
+    QString command = line.section(' ', 0, 0);
+    QString first = line.section(' ', 1, 1);
+    QString second = line.section(' ', 2, 2);
+    QString rest = line.section(' ', 3);
+
+    if (command == "contacts" && !first.isEmpty()) {
+        m_generator->populate(jid(first), second.toInt());
+    } else if (command == "contact" && !second.isEmpty()) {
+        m_server->addContact(jid(first), jid(second), rest);
+    } else if (command == "remove" && !second.isEmpty()) {
+        m_server->removeContact(jid(first), jid(second));
+    } else if (command == "presence" && !second.isEmpty()) {
+        m_server->setContactPresence(jid(first), second, rest);
+    } else if (command == "message" && !second.isEmpty()) {
+        m_server->sendMessage(jid(first), jid(second), QString(rest).replace("\\n", "\n"));
+    } else if (command == "churn" && !first.isEmpty()) {
+        m_generator->setPresenceChurn(jid(first), second.toInt());
+    } else if (command == "flood" && !second.isEmpty()) {
+        m_generator->flood(jid(first), second.toInt(), rest.toInt());
+    } else if (command == "sessions") {
+        foreach (const QString &session, m_server->sessions()) {
+            writeLine("session " + session);
+        }
+    } else if (command == "stats") {
+        writeLine(QString("stats sessions %1 routed %2 injected %3 presence %4 messages %5")
+                  .arg(m_server->sessions().count())
+                  .arg(m_server->routedBytes())
+                  .arg(m_server->injectedStanzas())
+                  .arg(m_generator->presenceSent())
+                  .arg(m_generator->messagesSent()));
+    } else if (command == "sleep") {
+        m_sleepTimer->start(first.toInt());
+    } else if (command == "quit") {
+        qApp->quit();
+    } else {
+        writeLine("error unknown command: " + line);
+    }
+}
+
+QString ServerConsole::jid(const QString &text) const
+{
+    if (text.contains('@'))
+        return text;
+    return text + "@" + m_server->domain();
+}
+
+void ServerConsole::writeLine(const QString &line)
+{
+    fputs(line.toUtf8().constData(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
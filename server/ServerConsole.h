@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SERVERCONSOLE_H
+#define SERVERCONSOLE_H
+
+#include <QObject>
+#include <QStringList>
+
+class QSocketNotifier;
+class QTimer;
+class LoopbackServer;
+class LoadGenerator;
+
+// Drives a LoopbackServer from stdin and from a script file, one command
+// per line. A jid without a domain gets the server's.
+//
+//   contacts <jid> <count>           add count simulated contacts
+//   contact <jid> <contact> [name]   add one contact
+//   remove <jid> <contact>
+//   presence <contact> <online|chat|away|xa|dnd|unavailable> [status]
+//   message <from> <to> <text>
+//   churn <jid> <perSecond>          random presence changes, 0 stops
+//   flood <jid> <count> [perSecond]  messages from random contacts
+//   sessions | stats
+//   sleep <msecs>                    delays the commands after it
+//   quit
+class ServerConsole : public QObject
+{
+    Q_OBJECT
+public:
+    ServerConsole(LoopbackServer *server, LoadGenerator *generator, QObject *parent = 0);
+    bool runScript(const QString &fileName);
+    void readStdin();
+
+private slots:
+    void stdinReadyRead();
+    void runPending();
+
+private:
+    LoopbackServer *m_server;
+    LoadGenerator *m_generator;
+    QSocketNotifier *m_stdinNotifier;
+    QByteArray m_stdinBuffer;
+    QStringList m_pending;
+    QTimer *m_sleepTimer;
+
+    void handleCommand(const QString &line);
+    QString jid(const QString &text) const;
+    void writeLine(const QString &line);
+};
+
+#endif // SERVERCONSOLE_H
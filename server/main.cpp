@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QStringList>
+#include "LoopbackServer.h"
+#include "LoadGenerator.h"
+#include "ServerConsole.h"
+#include <stdio.h>
+
+// qtalk-server [--port PORT] [--script FILE]
+//
+// A stand-in XMPP server on 127.0.0.1 (default port 5222) to point the
+// client at, with simulated contacts and load, see ServerConsole for the
+// commands read from the script and from stdin.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList arguments = app.arguments();
+
+    quint16 port = 5222;
+    int option = arguments.indexOf("--port");
+    if (option > 0 && option + 1 < arguments.count())
+        port = arguments.at(option + 1).toUShort();
+
+    LoopbackServer server;
+    if (!server.listen(port)) {
+        fprintf(stderr, "qtalk-server: can not listen on 127.0.0.1:%d\n", port);
+        return 1;
+    }
+    fprintf(stdout, "listening 127.0.0.1:%d %s\n", server.port(), qPrintable(server.domain()));
+    fflush(stdout);
+
+    LoadGenerator generator(&server);
+    ServerConsole console(&server, &generator);
+    console.readStdin();
+
+    option = arguments.indexOf("--script");
+    if (option > 0 && option + 1 < arguments.count()
+            && !console.runScript(arguments.at(option + 1))) {
+        fprintf(stderr, "qtalk-server: can not read %s\n", qPrintable(arguments.at(option + 1)));
+        return 1;
+    }
+
+    return app.exec();
+}
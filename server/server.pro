@@ -0,0 +1,17 @@
+TEMPLATE = app
+TARGET = qtalk-server
+QT += network xml
+QT -= gui
+
+# Stand-in XMPP server with simulated contacts, see main.cpp.
+
+CONFIG += console release
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+           LoopbackServer.cpp \
+           LoadGenerator.cpp \
+           ServerConsole.cpp
+HEADERS += LoopbackServer.h \
+           LoadGenerator.h \
+           ServerConsole.h
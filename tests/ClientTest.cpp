@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ClientTest.h"
+#include "TryVerify.h"
+#include <QXmppClient.h>
+#include <QXmppLogger.h>
+#include "LoopbackServer.h"
+#include "RosterModel.h"
+#include "Metrics.h"
+
+// simulated contacts in alice's roster, and how often they all change
+static const int Contacts = 50;
+static const int ChurnRounds = 11;
+
+static QString contact(int i)
+{
+    return QString("contact%1@localhost").arg(i);
+}
+
+ClientTest::ClientTest(QObject *parent) :
+    QObject(parent),
+    m_server(0),
+    m_alice(0),
+    m_bob(0),
+    m_model(0)
+{
+}
+
+void ClientTest::initTestCase()
+{
+    QXmppLogger::getLogger()->setLoggingType(QXmppLogger::NONE);
+
+    m_server = new LoopbackServer(this);
+    QVERIFY(m_server->listen());
+    QCOMPARE(m_server->domain(), QString("localhost"));
+
+    // in the roster before the first login, all offline
+    for (int i = 0; i < Contacts; i++)
+        m_server->addContact(alice(), contact(i), QString(), "Contacts");
+
+    m_alice = new QXmppClient(this);
+    m_bob = new QXmppClient(this);
+    m_model = new RosterModel(m_alice, this);
+    connect(m_alice, SIGNAL(messageReceived(QXmppMessage)),
+            this, SLOT(aliceMessage(QXmppMessage)) );
+    connect(m_bob, SIGNAL(messageReceived(QXmppMessage)),
+            this, SLOT(bobMessage(QXmppMessage)) );
+}
+
+void ClientTest::cleanupTestCase()
+{
+    delete m_model;
+    delete m_alice;
+    delete m_bob;
+    delete m_server;
+}
+
+void ClientTest::login()
+{
+    QSignalSpy aliceConnected(m_alice, SIGNAL(connected()));
+    QSignalSpy bobConnected(m_bob, SIGNAL(connected()));
+    QSignalSpy parsed(m_model, SIGNAL(parseDone()));
+
+    m_alice->connectToServer("127.0.0.1", alice(), "test", m_server->port());
+    m_bob->connectToServer("127.0.0.1", bob(), "test", m_server->port());
+    TRY_VERIFY(!aliceConnected.isEmpty());
+    TRY_VERIFY(!bobConnected.isEmpty());
+    TRY_VERIFY(!parsed.isEmpty());
+
+    QCOMPARE(m_server->sessions().count(), 2);
+    for (int i = 0; i < Contacts; i++) {
+        QModelIndex index = contactIndex(contact(i));
+        QVERIFY(index.isValid());
+        QCOMPARE(m_model->groupAt(index), QString("Contacts"));
+        QCOMPARE(m_model->rowCount(index), 0);
+    }
+}
+
+void ClientTest::rosterPush()
+{
+    QSignalSpy changed(&m_alice->getRoster(), SIGNAL(rosterChanged(QString)));
+    m_server->addContact(alice(), bob(), "Bob", "Friends");
+    TRY_VERIFY(!changed.isEmpty());
+
+    QModelIndex index = contactIndex(bob());
+    QVERIFY(index.isValid());
+    QCOMPARE(m_model->groupAt(index), QString("Friends"));
+    QVERIFY(m_model->getGroups().contains("Friends"));
+}
+
+void ClientTest::presenceChurn()
+{
+    QStringList contacts;
+    for (int i = 0; i < Contacts; i++)
+        contacts << contact(i);
+
+    qint64 coalesced = Metrics::counter("roster.presence.coalesced");
+    qint64 batches = Metrics::histogram("roster.presenceBatch").count();
+
+    // every contact goes away and comes back, the last round leaves them on
+    for (int round = 0; round < ChurnRounds; round++) {
+        foreach (const QString &each, contacts) {
+            if (round % 2)
+                m_server->setContactPresence(each, "unavailable");
+            else
+                m_server->setContactPresence(each, "away", QString("round %1").arg(round));
+        }
+    }
+    TRY_VERIFY(allOnline(contacts));
+
+    // the server sends the rounds in one go, a contact changing again
+    // within the same read is applied once, so there are far fewer
+    // batches than presences
+    qint64 presences = Contacts * ChurnRounds;
+    batches = Metrics::histogram("roster.presenceBatch").count() - batches;
+    QVERIFY(Metrics::counter("roster.presence.coalesced") - coalesced > 0);
+    QVERIFY(batches > 0);
+    QVERIFY(batches < presences);
+}
+
+void ClientTest::messageRoundTrip()
+{
+    qint64 routed = m_server->routedBytes();
+
+    m_alice->sendPacket(QXmppMessage(m_alice->getConfiguration().jid(), bob(), "ping"));
+    TRY_VERIFY(!m_bobMessages.isEmpty());
+    QCOMPARE(m_bobMessages.count(), 1);
+    QCOMPARE(m_bobMessages.first().body(), QString("ping"));
+    QCOMPARE(m_bobMessages.first().from(), m_alice->getConfiguration().jid());
+
+    // answer the full jid the message came from, like a chat window does
+    m_bob->sendPacket(QXmppMessage(m_bob->getConfiguration().jid(),
+                                   m_bobMessages.first().from(), "pong"));
+    TRY_VERIFY(!m_aliceMessages.isEmpty());
+    QCOMPARE(m_aliceMessages.count(), 1);
+    QCOMPARE(m_aliceMessages.first().body(), QString("pong"));
+    QVERIFY(m_server->routedBytes() > routed);
+}
+
+void ClientTest::aliceMessage(const QXmppMessage &message)
+{
+    // chat states come without a body
+    if (!message.body().isEmpty())
+        m_aliceMessages << message;
+}
+
+void ClientTest::bobMessage(const QXmppMessage &message)
+{
+    if (!message.body().isEmpty())
+        m_bobMessages << message;
+}
+
+QString ClientTest::alice() const
+{
+    return "alice@" + m_server->domain();
+}
+
+QString ClientTest::bob() const
+{
+    return "bob@" + m_server->domain();
+}
+
+QModelIndex ClientTest::contactIndex(const QString &bareJid) const
+{
+    foreach (QModelIndex index, m_model->allIndex()) {
+        if (m_model->itemTypeAt(index) == RosterModel::contact
+                && m_model->jidAt(index) == bareJid)
+            return index;
+    }
+    return QModelIndex();
+}
+
+// each contact shows its one resource in the model
+bool ClientTest::allOnline(const QStringList &contacts) const
+{
+    foreach (const QString &each, contacts) {
+        QModelIndex index = contactIndex(each);
+        if (!index.isValid() || m_model->rowCount(index) != 1)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CLIENTTEST_H
+#define CLIENTTEST_H
+
+#include <QObject>
+#include <QList>
+#include <QModelIndex>
+#include <QXmppMessage.h>
+
+class QXmppClient;
+class LoopbackServer;
+class RosterModel;
+
+// Logs two clients into a LoopbackServer in this process and checks what
+// the roster model and the message path make of it. The test functions
+// run in order and build on each other.
+class ClientTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClientTest(QObject *parent = 0);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void login();
+    void rosterPush();
+    void presenceChurn();
+    void messageRoundTrip();
+
+    void aliceMessage(const QXmppMessage &message);
+    void bobMessage(const QXmppMessage &message);
+
+private:
+    LoopbackServer *m_server;
+    QXmppClient *m_alice;
+    QXmppClient *m_bob;
+    RosterModel *m_model;
+    QList<QXmppMessage> m_aliceMessages;
+    QList<QXmppMessage> m_bobMessages;
+
+    QString alice() const;
+    QString bob() const;
+    QModelIndex contactIndex(const QString &bareJid) const;
+    bool allOnline(const QStringList &contacts) const;
+};
+
+#endif // CLIENTTEST_H
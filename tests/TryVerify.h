@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TRYVERIFY_H
+#define TRYVERIFY_H
+
+#include <QTime>
+#include <QtTest>
+
+// enough for anything on loopback, a failing test still ends
+#define TRY_TIMEOUT 5000
+
+// QVERIFY that keeps running the event loop until the expression holds or
+// TRY_TIMEOUT has passed, for what the server and the client do meanwhile
+#define TRY_VERIFY(expression) \
+    do { \
+        QTime tryClock; \
+        tryClock.start(); \
+        while (!(expression) && tryClock.elapsed() < TRY_TIMEOUT) \
+            QTest::qWait(10); \
+        QVERIFY(expression); \
+    } while (0)
+
+#endif // TRYVERIFY_H
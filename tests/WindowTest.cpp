@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "WindowTest.h"
+#include "TryVerify.h"
+#include <QListView>
+#include <QPushButton>
+#include <QSettings>
+#include <QStackedWidget>
+#include <QTreeView>
+#include <QXmppClient.h>
+#include <QXmppLogger.h>
+#include "LoopbackServer.h"
+#include "CapsTracker.h"
+#include "ChatWindow.h"
+#include "MainWindow.h"
+#include "MessageEdit.h"
+#include "MessageModel.h"
+#include "Preferences.h"
+#include "Outbox.h"
+#include "RosterModel.h"
+
+static QPushButton *sendButton(ChatWindow *window)
+{
+    foreach (QPushButton *button, window->findChildren<QPushButton *>()) {
+        if (button->text() == ChatWindow::tr("Send"))
+            return button;
+    }
+    return 0;
+}
+
+static QModelIndex findJid(RosterModel *model, const QString &jid)
+{
+    foreach (QModelIndex index, model->allIndex()) {
+        if (model->jidAt(index) == jid)
+            return index;
+    }
+    return QModelIndex();
+}
+
+WindowTest::WindowTest(QObject *parent) :
+    QObject(parent),
+    m_server(0),
+    m_dave(0)
+{
+}
+
+void WindowTest::initTestCase()
+{
+    QXmppLogger::getLogger()->setLoggingType(QXmppLogger::NONE);
+    QSettings().clear();
+
+    m_server = new LoopbackServer(this);
+    QVERIFY(m_server->listen());
+
+    m_dave = new QXmppClient(this);
+    connect(m_dave, SIGNAL(messageReceived(QXmppMessage)),
+            this, SLOT(daveMessage(QXmppMessage)) );
+    QSignalSpy connected(m_dave, SIGNAL(connected()));
+    m_dave->connectToServer("127.0.0.1", jid("dave"), "test", m_server->port());
+    TRY_VERIFY(!connected.isEmpty());
+}
+
+void WindowTest::cleanupTestCase()
+{
+    delete m_dave;
+    delete m_server;
+}
+
+void WindowTest::chatWindow()
+{
+    QXmppClient client;
+    Outbox outbox(&client);
+    CapsTracker capsTracker(&client);
+    connect(&client, SIGNAL(messageReceived(QXmppMessage)),
+            this, SLOT(carolMessage(QXmppMessage)) );
+    QSignalSpy connected(&client, SIGNAL(connected()));
+    client.connectToServer("127.0.0.1", jid("carol"), "test", m_server->port());
+    TRY_VERIFY(!connected.isEmpty());
+
+    ChatWindow *window = new ChatWindow(jid("dave"), &client, &outbox, &capsTracker);
+    QListView *view = window->findChild<QListView *>("messageView");
+    QVERIFY(view != 0);
+    QAbstractItemModel *messages = view->model();
+    QCOMPARE(messages->rowCount(), 0);
+
+    // typed and sent: shown at once, and dave gets it
+    MessageEdit *editor = window->findChild<MessageEdit *>();
+    QVERIFY(editor != 0);
+    QVERIFY(sendButton(window) != 0);
+    editor->setPlainText("hello dave");
+    sendButton(window)->click();
+    QVERIFY(editor->toPlainText().isEmpty());
+    QCOMPARE(messages->rowCount(), 1);
+    QCOMPARE(messages->index(0, 0).data(MessageModel::FromRole).toString(), jid("carol"));
+    QVERIFY(messages->index(0, 0).data(MessageModel::HtmlRole).toString().contains("hello dave"));
+    TRY_VERIFY(!m_daveMessages.isEmpty());
+    QCOMPARE(m_daveMessages.first().body(), QString("hello dave"));
+
+    // the answer, handed over the way MainWindow does for an open window
+    m_dave->sendPacket(QXmppMessage(m_dave->getConfiguration().jid(),
+                                    m_daveMessages.first().from(), "hi carol"));
+    TRY_VERIFY(!m_carolMessages.isEmpty());
+    window->appendMessage(m_carolMessages.first());
+    QCOMPARE(messages->rowCount(), 2);
+    QVERIFY(messages->index(1, 0).data(MessageModel::HtmlRole).toString().contains("hi carol"));
+
+    delete window;
+}
+
+void WindowTest::mainWindow()
+{
+    m_server->addContact(jid("frank"), jid("grace"), "Grace", "Friends");
+
+    // the window logs in by itself with what it finds in the preferences
+    Preferences preferences(0);
+    preferences.load();
+    preferences.jid = jid("frank");
+    preferences.password = "test";
+    preferences.host = "127.0.0.1";
+    preferences.port = m_server->port();
+    preferences.storePassword = true;
+    preferences.autoLogin = true;
+    preferences.save();
+
+    MainWindow *window = new MainWindow(0);
+    QStackedWidget *stack = window->findChild<QStackedWidget *>("stackedWidget");
+    QVERIFY(stack != 0);
+    QTreeView *rosterView = qobject_cast<QTreeView *>(stack->widget(1));
+    QVERIFY(rosterView != 0);
+    RosterModel *model = qobject_cast<RosterModel *>(rosterView->model());
+    QVERIFY(model != 0);
+
+    // the roster replaces the login form once it is parsed
+    TRY_VERIFY(stack->currentWidget() == rosterView);
+    QModelIndex grace = findJid(model, jid("grace"));
+    QVERIFY(grace.isValid());
+    QCOMPARE(model->groupAt(grace), QString("Friends"));
+
+    // a pushed contact shows up without a new login
+    m_server->addContact(jid("frank"), jid("heidi"), "Heidi", "Work");
+    TRY_VERIFY(findJid(model, jid("heidi")).isValid());
+
+    // a message without a chat window marks the resource unread
+    m_server->setContactPresence(jid("grace"), "online");
+    TRY_VERIFY(findJid(model, jid("grace") + "/loopback").isValid());
+    m_server->sendMessage(jid("grace"), jid("frank"), "hi frank");
+    TRY_VERIFY(findJid(model, jid("grace") + "/loopback").data().toString().startsWith("[*]"));
+
+    delete window;
+}
+
+void WindowTest::daveMessage(const QXmppMessage &message)
+{
+    // chat states come without a body
+    if (!message.body().isEmpty())
+        m_daveMessages << message;
+}
+
+void WindowTest::carolMessage(const QXmppMessage &message)
+{
+    if (!message.body().isEmpty())
+        m_carolMessages << message;
+}
+
+QString WindowTest::jid(const QString &user) const
+{
+    return user + "@" + m_server->domain();
+}
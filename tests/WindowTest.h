@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef WINDOWTEST_H
+#define WINDOWTEST_H
+
+#include <QObject>
+#include <QList>
+#include <QXmppMessage.h>
+
+class QXmppClient;
+class LoopbackServer;
+
+// The chat window, with its Outbox and CapsTracker, and the main
+// window against a LoopbackServer in this process, with dave@localhost as
+// the contact on the other end.
+class WindowTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WindowTest(QObject *parent = 0);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void chatWindow();
+    void mainWindow();
+
+    void daveMessage(const QXmppMessage &message);
+    void carolMessage(const QXmppMessage &message);
+
+private:
+    LoopbackServer *m_server;
+    QXmppClient *m_dave;
+    QList<QXmppMessage> m_daveMessages;
+    QList<QXmppMessage> m_carolMessages;
+
+    QString jid(const QString &user) const;
+};
+
+#endif // WINDOWTEST_H
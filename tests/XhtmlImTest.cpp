@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "XhtmlImTest.h"
+#include <QtTest>
+#include "XhtmlIm.h"
+
+// the limits in XhtmlIm.cpp
+static const int MaxInputLength = 256 * 1024;
+static const int MaxOutputLength = 64 * 1024;
+static const int MaxElements = 2000;
+static const int MaxDepth = 32;
+
+static QString sanitize(const QString &body)
+{
+    return XhtmlIm::sanitize(XhtmlIm::wrap(body));
+}
+
+static QString nested(int depth)
+{
+    return QString("<span>").repeated(depth) + "deep" + QString("</span>").repeated(depth);
+}
+
+XhtmlImTest::XhtmlImTest(QObject *parent) :
+    QObject(parent)
+{
+}
+
+void XhtmlImTest::keepsAllowedMarkup()
+{
+    QCOMPARE(sanitize("<p>plain <strong>bold</strong> <em>and</em> more</p>"),
+             QString("<p>plain <strong>bold</strong> <em>and</em> more</p>"));
+    // unknown elements go, their text stays
+    QCOMPARE(sanitize("<p><blink>text</blink></p>"), QString("<p>text</p>"));
+}
+
+void XhtmlImTest::dropsScriptAndStyle()
+{
+    QCOMPARE(sanitize("<p>hi<script>alert(1)</script></p>"), QString("<p>hi</p>"));
+    QCOMPARE(sanitize("<style>p { color: red }</style><p>hi</p>"), QString("<p>hi</p>"));
+    QCOMPARE(sanitize("<p>a<img src=\"http://example.com/x.png\"/>b</p>"), QString("<p>ab</p>"));
+    // nothing inside a dropped element survives, allowed or not
+    QCOMPARE(sanitize("<script><p>inner</p></script>after"), QString("after"));
+}
+
+void XhtmlImTest::dropsUnsafeHrefs()
+{
+    QCOMPARE(sanitize("<a href=\"http://example.com/\">link</a>"),
+             QString("<a href=\"http://example.com/\">link</a>"));
+    QCOMPARE(sanitize("<a href=\"javascript:alert(1)\">link</a>"), QString("<a>link</a>"));
+    QCOMPARE(sanitize("<a href=\" JavaScript:alert(1)\">link</a>"), QString("<a>link</a>"));
+    QCOMPARE(sanitize("<a href=\"data:text/html,x\">link</a>"), QString("<a>link</a>"));
+    QCOMPARE(sanitize("<a href=\"relative/path\">link</a>"), QString("<a>link</a>"));
+}
+
+void XhtmlImTest::dropsUnsafeStyles()
+{
+    QCOMPARE(sanitize("<span style=\"color: red; position: fixed\">x</span>"),
+             QString("<span style=\"color:red\">x</span>"));
+    QCOMPARE(sanitize("<span style=\"background-color: url(http://example.com/)\">x</span>"),
+             QString("<span>x</span>"));
+    QCOMPARE(sanitize("<p onclick=\"alert(1)\">x</p>"), QString("<p>x</p>"));
+}
+
+void XhtmlImTest::rejectsDeepNesting()
+{
+    QCOMPARE(sanitize(nested(MaxDepth)), nested(MaxDepth));
+    QVERIFY(sanitize(nested(MaxDepth + 1)).isEmpty());
+}
+
+void XhtmlImTest::rejectsLongInput()
+{
+    QString body = QString("x").repeated(MaxInputLength);
+    QVERIFY(XhtmlIm::wrap(body).length() > MaxInputLength);
+    QVERIFY(sanitize(body).isEmpty());
+}
+
+void XhtmlImTest::rejectsManyElements()
+{
+    QVERIFY(!sanitize(QString("<br/>").repeated(MaxElements)).isEmpty());
+    QVERIFY(sanitize(QString("<br/>").repeated(MaxElements + 1)).isEmpty());
+}
+
+void XhtmlImTest::rejectsLongOutput()
+{
+    // well inside the input limit, but escaping makes the output grow
+    QString body = QString("&lt;").repeated(MaxOutputLength / 2);
+    QVERIFY(body.length() < MaxInputLength);
+    QVERIFY(sanitize(body).isEmpty());
+    QCOMPARE(sanitize(QString("x").repeated(MaxOutputLength)).length(), MaxOutputLength);
+}
+
+void XhtmlImTest::rejectsMalformed()
+{
+    QVERIFY(sanitize("<p>unclosed").isEmpty());
+    QVERIFY(XhtmlIm::sanitize("not xml at all <").isEmpty());
+}
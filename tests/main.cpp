@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 Rei
+ *
+ * Author:
+ *	Rei
+ *
+ * Source:
+ *	http://github.com/chloerei/qtalk
+ *
+ * This file is a part of QTalk.
+ *
+ * QTalk is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QTalk is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QTalk.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QApplication>
+#include <QtTest>
+#include "ClientTest.h"
+#include "WindowTest.h"
+#include "XhtmlImTest.h"
+#include "Logger.h"
+
+// qtalk-tests [QtTest options]
+//
+// Every test object that needs a server starts its own LoopbackServer on a
+// free port. The windows are real widgets, so a display is needed (Xvfb
+// will do).
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    // preferences of their own, the user's are never touched
+    QCoreApplication::setOrganizationName("chloerei");
+    QCoreApplication::setApplicationName("qtalk-tests");
+    Logger::setLevel(Logger::Off);
+
+    int result = 0;
+    ClientTest clientTest;
+    result |= QTest::qExec(&clientTest, argc, argv);
+    WindowTest windowTest;
+    result |= QTest::qExec(&windowTest, argc, argv);
+    XhtmlImTest xhtmlImTest;
+    result |= QTest::qExec(&xhtmlImTest, argc, argv);
+    return result;
+}
@@ -0,0 +1,131 @@
+TEMPLATE = app
+TARGET = qtalk-tests
+QT += network xml
+CONFIG += qtestlib
+
+# The client against a loopback server in the same process, see main.cpp.
+
+CONFIG += console release
+CONFIG -= app_bundle
+INCLUDEPATH += ../lib/QXmppClient/source ../app ../server
+
+QXMPP_LIB = QXmppClient
+QXMPP_DIR = ../lib/QXmppClient/source/release
+LIBS += -L$$QXMPP_DIR -l$$QXMPP_LIB
+PRE_TARGETDEPS += $${QXMPP_DIR}/lib$${QXMPP_LIB}.a
+
+RESOURCES = ../app/application.qrc
+
+# test the code the application ships, everything but its main()
+SOURCES += main.cpp \
+           ClientTest.cpp \
+           WindowTest.cpp \
+           XhtmlImTest.cpp \
+           ../server/LoopbackServer.cpp \
+           ../app/HeadlessClient.cpp \
+           ../app/Outbox.cpp \
+           ../app/ReconnectScheduler.cpp \
+           ../app/MainWindow.cpp \
+           ../app/ChatWindow.cpp \
+           ../app/MessageModel.cpp \
+           ../app/MessageDelegate.cpp \
+           ../app/XmppMessage.cpp \
+           ../app/XhtmlIm.cpp \
+           ../app/RosterModel.cpp \
+           ../app/VCardCache.cpp \
+           ../app/IconCache.cpp \
+           ../app/TrayIcon.cpp \
+           ../app/StartupTrace.cpp \
+           ../app/Logger.cpp \
+           ../app/RotatingFile.cpp \
+           ../app/Metrics.cpp \
+           ../app/MetricsServer.cpp \
+           ../app/DiagnosticsWindow.cpp \
+           ../app/StallWatchdog.cpp \
+           ../app/UnreadMessageWindow.cpp \
+           ../app/UnreadMessageModel.cpp \
+           ../app/LoginWidget.cpp \
+           ../app/PreferencesDialog.cpp \
+           ../app/PrefAccount.cpp \
+           ../app/Preferences.cpp \
+           ../app/PrefWidget.cpp \
+           ../app/PrefGeneral.cpp \
+           ../app/CloseNoticeDialog.cpp \
+           ../app/PrefChatWindow.cpp \
+           ../app/MessageEdit.cpp \
+           ../app/ContactInfoDialog.cpp \
+           ../app/TransferManagerWindow.cpp \
+           ../app/TransferManagerModel.cpp \
+           ../app/TransferRate.cpp \
+           ../app/TransferScheduler.cpp \
+           ../app/IncomingFile.cpp \
+           ../app/OutgoingHash.cpp \
+           ../app/ProxySelector.cpp \
+           ../app/CapsCache.cpp \
+           ../app/CapsTracker.cpp \
+           ../app/AddContactDialog.cpp \
+           ../app/InfoEventStackWidget.cpp \
+           ../app/InfoEventSubscribeRequest.cpp
+HEADERS += ClientTest.h \
+           WindowTest.h \
+           XhtmlImTest.h \
+           TryVerify.h \
+           ../server/LoopbackServer.h \
+           ../app/MainWindow.h \
+           ../app/HeadlessClient.h \
+           ../app/Outbox.h \
+           ../app/ReconnectScheduler.h \
+           ../app/ChatWindow.h \
+           ../app/MessageModel.h \
+           ../app/MessageDelegate.h \
+           ../app/XmppMessage.h \
+           ../app/XhtmlIm.h \
+           ../app/RosterModel.h \
+           ../app/VCardCache.h \
+           ../app/IconCache.h \
+           ../app/TrayIcon.h \
+           ../app/StartupTrace.h \
+           ../app/Logger.h \
+           ../app/RotatingFile.h \
+           ../app/Metrics.h \
+           ../app/MetricsServer.h \
+           ../app/DiagnosticsWindow.h \
+           ../app/StallWatchdog.h \
+           ../app/UnreadMessageWindow.h \
+           ../app/UnreadMessageModel.h \
+           ../app/LoginWidget.h \
+           ../app/PreferencesDialog.h \
+           ../app/PrefAccount.h \
+           ../app/Preferences.h \
+           ../app/PrefWidget.h \
+           ../app/PrefGeneral.h \
+           ../app/CloseNoticeDialog.h \
+           ../app/PrefChatWindow.h \
+           ../app/MessageEdit.h \
+           ../app/ContactInfoDialog.h \
+           ../app/TransferManagerWindow.h \
+           ../app/TransferManagerModel.h \
+           ../app/TransferRate.h \
+           ../app/TransferScheduler.h \
+           ../app/IncomingFile.h \
+           ../app/OutgoingHash.h \
+           ../app/ProxySelector.h \
+           ../app/CapsCache.h \
+           ../app/CapsTracker.h \
+           ../app/AddContactDialog.h \
+           ../app/InfoEventStackWidget.h \
+           ../app/InfoEventSubscribeRequest.h
+FORMS   += ../app/MainWindow.ui \
+           ../app/UnreadMessageWindow.ui \
+           ../app/LoginWidget.ui \
+           ../app/ChatWindow.ui \
+           ../app/PreferencesDialog.ui \
+           ../app/PrefAccount.ui \
+           ../app/PrefGeneral.ui \
+           ../app/CloseNoticeDialog.ui \
+           ../app/PrefChatWindow.ui \
+           ../app/ContactInfoDialog.ui \
+           ../app/TransferManagerWindow.ui \
+           ../app/AddContactDialog.ui \
+           ../app/InfoEventStackWidget.ui \
+           ../app/InfoEventSubscribeRequest.ui